@@ -7,15 +7,36 @@
 
 #include <leptonica/allheaders.h>
 
+#include <math.h>
+#include <time.h>
+
+#include "area-prefilter.h"
+#include "area-scores.h"
+#include "area-watch.h"
+#include "banner-debounce.h"
+#include "debug-writer.h"
+#include "detection-cache.h"
+#include "frame-recorder.h"
+#include "glyph-mask.h"
+#include "hud-export.h"
+#include "hud-tables.h"
 #include "images.h"
+#include "latency-stats.h"
+#include "layout-pack.h"
+#include "reference-arena.h"
+#include "ssd-kernels.h"
+#include "work-arena.h"
+#include "worker-pool.h"
 
 #define PROJECT_VERSION "1.5.0"
 
 #define DEBUG_FRAME_INTERVAL        300
-#define DEBUG_SAVE_PATH             "C:\\Temp"
-#define DEBUG_SAVE_PATH_NAME_LEN    128
+#define DEBUG_SAVE_PATH_NAME_LEN    512
 
 #define PSNR_THRESHOLD_VALUE        16.5f
+#define NCC_THRESHOLD_VALUE         0.8f
+/* not calibrated on captures yet, the glyph mask is never the default metric */
+#define GLYPH_THRESHOLD_VALUE       0.75f
 
 #define write_log(log_level, format, ...) blog(log_level, "[apex-game] " format, ##__VA_ARGS__)
 
@@ -24,161 +45,346 @@
 #define bwarn(format, ...) write_log(LOG_WARNING, format, ##__VA_ARGS__)
 #define berr(format, ...) write_log(LOG_ERROR, format, ##__VA_ARGS__)
 
-enum character_name
-{
-    BLOODHOUND,
-    GIBRALTAR,
-    LIFELINE,
-    PATHFINDER,
-    WRAITH,
-    BANGALORE,
-    CAUSTIC,
-    MIRAGE,
-    OCTANE,
-    WATTSON,
-    CRYPTO,
-    REVENANT,
-    LOBA,
-    RAMPART,
-    HORIZON,
-    FUSE,
-    VALKYRIE,
-    SEER,
-    ASH,
-    MADMAGGIE,
-    NEWCASTLE,
-    VANTAGE,
-    CATALYST,
-    BALLISTIC,
-
-    CHARACTERS_NUM
+/* settings of the sources enabled with the banners */
+static const char *target_source_keys[BANNER_POSITION_NUM] =
+{
+    [BANNER_GAME] =         "game_source",
+    [BANNER_LOOTING] =      "looting_source",
+    [BANNER_INVENTORY] =    "inventory_source",
+    [BANNER_MAP] =          "map_source",
+    [BANNER_SPECTATE] =     "spectate_source",
 };
-typedef enum character_name character_name_t;
-
-const char *character_name_str[CHARACTERS_NUM] =
-{
-    "bloodhound",
-    "gibraltar",
-    "lifeline",
-    "pathfinder",
-    "wraith",
-    "bangalore",
-    "caustic",
-    "mirage",
-    "octane",
-    "wattson",
-    "crypto",
-    "revenant",
-    "loba",
-    "rampart",
-    "horizon",
-    "fuse",
-    "valkyrie",
-    "seer",
-    "ash",
-    "madmaggie",
-    "newcastle",
-    "vantage",
-    "catalyst",
-    "ballistic",
+
+
+/*
+ * the counters are not read, only their changes are reported
+ */
+enum hud_counter
+{
+    COUNTER_SQUADS_LEFT,
+    COUNTER_KILLS,
+
+    COUNTERS_NUM
 };
 
-enum banner_position
+const char *hud_counter_str[COUNTERS_NUM] =
 {
-    BANNER_GAME,
-    BANNER_LOOTING,
-    BANNER_INVENTORY,
-    BANNER_MAP,
-    BANNER_SPECTATE,
+    "squads_left",
+    "kills",
+};
 
-    BANNER_POSITION_NUM
+static const area_name_t counter_areas[COUNTERS_NUM] =
+{
+    [COUNTER_SQUADS_LEFT] =     SQUADS_LEFT_IMAGE,
+    [COUNTER_KILLS] =           KILL_COUNT_IMAGE,
 };
-typedef enum banner_position banner_position_t;
-
-enum area_name
-{
-    MAP_GAME_BUTTON,
-    GRENADE_GAME_BUTTON,
-    ESC_LOOTING_BUTTON,
-    ESC_INVENTORY_BUTTON,
-    GRAYBAR_INVENTORY_BUTTON,
-    M_MAP_BUTTON,
-    PG_BANNER_IMAGE,
-    PAD_MAP_BUTTON,
-    PAD_LOOTING_BUTTON,
-    PAD_INVENTORY_BUTTON,
-    PAD_TACTICAL_BUTTON,
-    SPECTATE_IMAGE_RED,
-    SPECTATE_IMAGE_GREEN,
-    SPECTATE_IMAGE_ORANGE,
-    SPECTATE_IMAGE_BLUE,
-
-    AREAS_NUM
+
+
+/*
+ * normalized cross-correlation on luma is not affected by the red pulse that
+ * tints the character banner when the player receives damage
+ */
+static const match_metric_t default_area_metrics[AREAS_NUM] =
+{
+    [PG_BANNER_IMAGE] =         METRIC_LUMA_NCC,
 };
-typedef enum area_name area_name_t;
-
-const char *area_name_str[AREAS_NUM] =
-{
-    "MAP_GAME_BUTTON",
-    "GRENADE_GAME_BUTTON",
-    "ESC_LOOTING_BUTTON",
-    "ESC_INVENTORY_BUTTON",
-    "GRAYBAR_INVENTORY_BUTTON",
-    "M_MAP_BUTTON",
-    "PG_BANNER_IMAGE",
-    "PAD_MAP_BUTTON",
-    "PAD_LOOTING_BUTTON",
-    "PAD_INVENTORY_BUTTON",
-    "PAD_TACTICAL_BUTTON",
-    "SPECTATE_IMAGE_RED",
-    "SPECTATE_IMAGE_GREEN",
-    "SPECTATE_IMAGE_ORANGE",
-    "SPECTATE_IMAGE_BLUE",
+
+
+
+
+
+struct area
+{
+    uint32_t x;
+    uint32_t y;
+    uint32_t w;
+    uint32_t h;
 };
+typedef struct area area_t;
 
-enum input_device
+#define SPECTATE_HUE_BINS   24
+
+enum frame_format
 {
-    MOUSE_AND_KEYBOARD,
-    PLAY_STATION_PAD,
+    FRAME_RGBA,
+    FRAME_BGRA,
+    FRAME_NV12,
+    FRAME_I420,
+    FRAME_REGIONS,      /* RGBA render of the HUD regions only */
 
-    INPUT_DEVICES_NUM
+    FRAME_FORMATS_NUM
 };
 
-enum display_resolution
+/*
+ * parts of the screen rendered when only the HUD regions are rendered, every
+ * area belongs to one of them
+ */
+enum render_region
 {
-    DISPLAY_1080P,
-    DISPLAY_2K,
+    REGION_TOP_LEFT,        /* map */
+    REGION_BOTTOM_LEFT,     /* banners, inventory and the gray lines */
+    REGION_BOTTOM_CENTER,   /* spectate */
+    REGION_BOTTOM_RIGHT,    /* grenade */
+    REGION_TOP_RIGHT,       /* counters */
+
+    RENDER_REGIONS_NUM
+};
 
-    DISPLAY_RESOLUTIONS
+const char *render_region_str[RENDER_REGIONS_NUM] =
+{
+    "top-left",
+    "bottom-left",
+    "bottom-center",
+    "bottom-right",
+    "top-right",
 };
 
-enum game_language
+static const enum render_region area_regions[AREAS_NUM] =
 {
-    LANGUAGE_IT,
-    LANGUAGE_EN,
-    LANGUAGE_ZH,
+    [MAP_GAME_BUTTON] =             REGION_TOP_LEFT,
+    [GRENADE_GAME_BUTTON] =         REGION_BOTTOM_RIGHT,
+    [ESC_LOOTING_BUTTON] =          REGION_BOTTOM_LEFT,
+    [ESC_INVENTORY_BUTTON] =        REGION_BOTTOM_LEFT,
+    [GRAYBAR_INVENTORY_BUTTON] =    REGION_BOTTOM_LEFT,
+    [M_MAP_BUTTON] =                REGION_BOTTOM_LEFT,
+    [PG_BANNER_IMAGE] =             REGION_BOTTOM_LEFT,
+    [PAD_MAP_BUTTON] =              REGION_BOTTOM_LEFT,
+    [PAD_LOOTING_BUTTON] =          REGION_BOTTOM_LEFT,
+    [PAD_INVENTORY_BUTTON] =        REGION_BOTTOM_LEFT,
+    [PAD_TACTICAL_BUTTON] =         REGION_BOTTOM_LEFT,
+    [SPECTATE_IMAGE_RED] =          REGION_BOTTOM_CENTER,
+    [SPECTATE_IMAGE_GREEN] =        REGION_BOTTOM_CENTER,
+    [SPECTATE_IMAGE_ORANGE] =       REGION_BOTTOM_CENTER,
+    [SPECTATE_IMAGE_BLUE] =         REGION_BOTTOM_CENTER,
+    [SQUADS_LEFT_IMAGE] =           REGION_TOP_RIGHT,
+    [KILL_COUNT_IMAGE] =            REGION_TOP_RIGHT,
+};
 
-    LANGUAGES
+/* data is the mapped staging copy of the box, top-down */
+struct frame_region
+{
+    area_t box;
+    uint8_t *data;
+    uint32_t linesize;
 };
 
-struct area
+struct frame_view
+{
+    enum frame_format format;
+    uint8_t *planes[3];
+    uint32_t linesize[3];
+    uint32_t height;
+    bool flip;
+    int32_t yuv_matrix[3][4];
+    uint64_t timestamp_ns;
+    const struct frame_region *regions;     /* RENDER_REGIONS_NUM for FRAME_REGIONS */
+};
+
+struct spectate_template
 {
-    uint32_t x;
-    uint32_t y;
     uint32_t w;
     uint32_t h;
+    uint8_t *mask;
+    uint32_t glyph_pixels;
+    uint32_t hue_bin[SPECTATE_COLORS_NUM];
 };
-typedef struct area area_t;
 
-struct apex_game_filter_context
+enum record_mode
 {
-    PIX *image;
+    RECORD_OFF,
+    RECORD_AREAS,
+    RECORD_FRAMES,
+
+    RECORD_MODES_NUM
+};
+
+/*
+ * the settings read by the detection: the update fills them on the ui thread
+ * and the video thread copies them into the filter when no detection is
+ * running, as for the layout, see apply_pending_settings()
+ */
+struct filter_settings
+{
+    bool debug_mode;
+    bool threaded;
+    bool parallel;
+    bool region_render;
+    bool shared_detection;
+    enum game_language language;        /* until detected when language_auto */
+    bool language_auto;
+    enum input_device input;            /* until detected when input_auto */
+    bool input_auto;
+    match_metric_t area_metrics[AREAS_NUM];
+    struct debounce_settings debounce;
+    enum record_mode record_mode;
+    uint32_t record_interval;
+    bool record_restart;                /* a new recording was started */
+    uint64_t detection_config;
+};
+
+const char *record_mode_str[RECORD_MODES_NUM] =
+{
+    "off",
+    "areas",
+    "frames",
+};
+
+#define RECORD_AREAS_MAX    (AREAS_NUM * LANGUAGES * 2)
+
+#define PROBE_LOCK_HITS     15
+#define PROBE_INTERVAL      30
+
+struct auto_probe
+{
+    bool input_auto;
+    bool language_auto;
+    bool input_locked;
+    bool language_locked;
+    int input_hits[INPUT_DEVICES_NUM];
+    int language_hits[LANGUAGES];
+    uint32_t frame;
+};
+
+struct detection_result
+{
+    bool banners[BANNER_POSITION_NUM];
+    float confidence[BANNER_POSITION_NUM];
+    character_name_t character;
+    spectate_color_t spectate_color;
+    uint32_t counter_changes[COUNTERS_NUM];
+    uint64_t timestamp_ns;
+    struct latency_sample latency;
+    const void *detector;           /* filter that matched the frame, see publish_result() */
+};
+
+/*
+ * state published to other plugins and scripts through the hud_changed signal
+ * and the get_hud_state procedure of the filter
+ */
+struct hud_state
+{
+    uint32_t banners;
+    character_name_t character;
+    spectate_color_t spectate_color;
+    uint64_t timestamp_ns;
+    uint32_t counter_changes[COUNTERS_NUM];
+};
+
+static const char *hud_signals[] =
+{
+    "void hud_changed(ptr source, int banners, string hud, int character, string character_name, "
+    "int spectate_color, string spectate_color_name, int timestamp)",
+    "void counter_changed(ptr source, string counter, int changes, int timestamp)",
+    NULL,
+};
+
+#define DETECTORS_MAX       8
+
+/*
+ * time of the specialized kernel of an area and of the generic one on the same
+ * comparisons, only measured in debug mode. one per area, the detectors of
+ * different areas run in parallel.
+ */
+struct ssd_benchmark
+{
+    uint64_t specialized_ns;
+    uint64_t generic_ns;
+    uint32_t calls;
+    uint32_t mismatches;
+};
+
+struct apex_game_filter_context;
+
+struct detector_job
+{
+    struct apex_game_filter_context *filter;
+    void (*detect)(struct apex_game_filter_context *filter);
+};
+
+struct hud_tracker
+{
+    int dx;
+    int dy;
+    bool locked;
+};
+
+/*
+ * the PSNR comparison is decided on the sum of squared differences of the
+ * channels of the area. the threshold of every area is converted once per
+ * layout into bounds of the squared error per pixel (16.16 fixed point), one
+ * per step of confidence between PSNR_CONFIDENCE_MIN and PSNR_CONFIDENCE_MAX:
+ * a comparison only multiplies them by the pixels of the area, the PSNR
+ * itself is computed for the debug output only.
+ */
+#define PSNR_CONFIDENCE_MIN     -4
+#define PSNR_CONFIDENCE_MAX     4
+#define PSNR_CONFIDENCE_STEPS   8
+#define PSNR_KNOTS              ((PSNR_CONFIDENCE_MAX - PSNR_CONFIDENCE_MIN) * PSNR_CONFIDENCE_STEPS + 1)
+#define PSNR_KNOT_THRESHOLD     (-PSNR_CONFIDENCE_MIN * PSNR_CONFIDENCE_STEPS)
+#define SSD_FRACTION_BITS       16
+/* above the squared error of any pixel, keeps the bounds of an area in 64 bits */
+#define SSD_KNOT_MAX            (1ULL << 40)
+
+struct psnr_bounds
+{
+    uint64_t knots[PSNR_KNOTS];     /* decreasing, knots[i] for confidence MIN + i / STEPS */
+};
+
+/*
+ * the references of a display are indexed by area, then by character for the
+ * character banner, see layout_reference()
+ */
+#define REFERENCES_NUM      (AREAS_NUM + CHARACTERS_NUM)
+
+/*
+ * everything that depends on the HUD of a specific game version: either the
+ * compiled-in tables or the ones of a layout pack, copied in pack_areas and
+ * pack_offsets
+ */
+struct layout
+{
+    const area_t *areas[DISPLAY_RESOLUTIONS][LANGUAGES];
+    const int32_t *match_offsets[DISPLAY_RESOLUTIONS];
+    float thresholds[DISPLAY_RESOLUTIONS][AREAS_NUM][METRICS_NUM];
+    struct psnr_bounds psnr_bounds[DISPLAY_RESOLUTIONS][AREAS_NUM];
     PIX *banner_references[DISPLAY_RESOLUTIONS][AREAS_NUM];
     PIX *pg_references[DISPLAY_RESOLUTIONS][CHARACTERS_NUM];
+    struct reference_arena reference_arenas[DISPLAY_RESOLUTIONS];
+    struct prefilter_reference pg_prefilters[DISPLAY_RESOLUTIONS][CHARACTERS_NUM];
+    struct glyph_mask glyph_masks[DISPLAY_RESOLUTIONS][AREAS_NUM];
+    struct spectate_template spectate_templates[DISPLAY_RESOLUTIONS];
+    /*
+     * copies of the tables of the pack, the pack is closed once loaded: the
+     * pages of a private mapping still follow the file until written
+     */
+    area_t pack_areas[DISPLAY_RESOLUTIONS][LANGUAGES][AREAS_NUM];
+    int32_t pack_offsets[DISPLAY_RESOLUTIONS][AREAS_NUM];
+};
+
+struct apex_game_filter_context
+{
+    PIX *image;
+    struct layout *layout;
+    struct layout *pending_layout;
+    struct filter_settings pending_settings;
+    bool settings_pending;
+    pthread_mutex_t layout_mutex;           /* pending layout and settings */
+    char *layout_path;
+    match_metric_t area_metrics[AREAS_NUM];
     obs_source_t *source;
+    /*
+     * the sources are looked up by name when their setting changes and again
+     * after a source is created, renamed or removed, see
+     * target_source_signal(). the mutex is taken by the update (ui thread)
+     * and by apply_result() (graphics thread).
+     */
+    pthread_mutex_t target_mutex;
+    char *target_names[BANNER_POSITION_NUM];
     obs_weak_source_t *target_sources[BANNER_POSITION_NUM];
+    volatile bool targets_stale;
     uint8_t *video_data;
     uint32_t video_linesize;
+    struct frame_view frame;
     uint32_t width;
     uint32_t height;
     enum display_resolution display;
@@ -186,10 +392,73 @@ struct apex_game_filter_context
     enum game_language language;
     gs_texrender_t *texrender;
     gs_stagesurf_t *stagesurface;
+    bool region_render;
+    /*
+     * entry of the detection cache of the parent and configuration, the
+     * filter either detects a frame or takes the result of the filter that
+     * did
+     */
+    bool shared_detection;
+    uint64_t detection_config;
+    struct detection_cache_entry *detection_entry;
+    const obs_source_t *detection_parent;
+    uint64_t detection_entry_config;
+    uint64_t detection_sequence;
+    const void *counters_detector;
+    const struct layout *region_layout;
+    enum display_resolution region_display;
+    struct frame_region regions[RENDER_REGIONS_NUM];
+    gs_texrender_t *region_texrenders[RENDER_REGIONS_NUM];
+    gs_stagesurf_t *region_stagesurfaces[RENDER_REGIONS_NUM];
     bool closing;
+    bool async;
     bool debug_mode;
     uint32_t debug_counter;
+    pthread_mutex_t debug_mutex;
+    char debug_path[DEBUG_SAVE_PATH_NAME_LEN];
     const area_t *areas;
+    struct hud_tracker inventory_tracker;
+    struct auto_probe probe;
+    struct detection_result result;
+    bool result_ready;
+    struct debounce_settings debounce;
+    struct banner_debouncer debouncers[BANNER_POSITION_NUM];
+    struct area_watch counter_watches[COUNTERS_NUM];
+    uint64_t watch_evaluations;
+    bool threaded;
+    struct worker_group detection;
+    bool parallel;
+    bool areas_filled;
+    struct worker_group detectors;
+    struct detector_job detector_jobs[DETECTORS_MAX];
+    uint64_t match_time_ns;
+    uint32_t match_count;
+    struct work_arena work;
+    const struct layout *work_layout;
+    const area_t *work_areas;
+    struct prefilter_frame pg_prefilter;
+    size_t pg_prefilter_size;
+    const area_t *kernel_areas;
+    struct ssd_kernel area_kernels[AREAS_NUM];
+    struct ssd_benchmark ssd_benchmarks[AREAS_NUM];
+    uint64_t prefilter_rejects[PREFILTER_LEVELS];
+    uint64_t prefilter_compares;
+    uint32_t prefilter_frames;
+    uint64_t match_allocations;
+    uint32_t match_allocation_frames;
+    pthread_mutex_t state_mutex;
+    struct hud_state state;
+    struct hud_export *export;
+    char *export_name;
+    uint64_t export_frame;
+    struct latency_sample latency;
+    struct latency_stats latency_stats;
+    struct frame_recorder *recorder;
+    enum record_mode record_mode;
+    uint32_t record_interval;
+    uint32_t record_counter;
+    bool record_compress;
+    char *record_path;
 };
 typedef struct apex_game_filter_context apex_game_filter_context_t;
 
@@ -329,6 +598,37 @@ typedef struct apex_game_filter_context apex_game_filter_context_t;
 #define SPECTATE_IMAGE_2K_W             22
 #define SPECTATE_IMAGE_2K_H             22
 
+/*
+ * detection jobs of all the filter instances are executed by a single pool
+ * shared by the whole module
+ */
+static struct worker_pool *detection_pool;
+
+/*
+ * debug captures are encoded to PNG by a background thread, off the video and
+ * detection threads
+ */
+static struct debug_writer *debug_writer;
+
+/* results shared by the filters on the same parent, see detection-cache.h */
+static struct detection_cache *detection_cache;
+
+/*
+ * updates of all the filters since the module was loaded, the load time of a
+ * scene collection is the total logged by its last filter in debug mode
+ */
+static volatile long updates_count;
+static volatile long updates_us;
+
+static void add_update_time(uint64_t elapsed_ns)
+{
+    long total;
+
+    do {
+        total = os_atomic_load_long(&updates_us);
+    } while (!os_atomic_compare_swap_long(&updates_us, total, total + (long)(elapsed_ns / 1000)));
+}
+
 static const area_t areas_1080p_en[AREAS_NUM] =
 {
     [MAP_GAME_BUTTON] =         { MAP_GAME_BUTTON_X,            MAP_GAME_BUTTON_Y,          MAP_GAME_BUTTON_W,          MAP_GAME_BUTTON_H           },
@@ -444,6 +744,47 @@ static const area_t areas_2k_zh[AREAS_NUM] =
     [SPECTATE_IMAGE_BLUE] =     { SPECTATE_IMAGE_2K_X,              SPECTATE_IMAGE_2K_Y,            SPECTATE_IMAGE_2K_W,            SPECTATE_IMAGE_2K_H             },
 };
 
+
+/*
+ * one kernel of fixed size per area of the compiled-in tables, the sizes do
+ * not depend on the language. the areas of a layout pack with one of these
+ * sizes use them too, the others the generic kernel.
+ */
+#define SSD_KERNEL_AREAS(X) \
+    X(map_game_button,              MAP_GAME_BUTTON_W,              MAP_GAME_BUTTON_H) \
+    X(grenade_game_button,          GRENADE_GAME_BUTTON_W,          GRENADE_GAME_BUTTON_H) \
+    X(esc_looting_button,           ESC_LOOTING_BUTTON_W,           ESC_LOOTING_BUTTON_H) \
+    X(esc_inventory_button,         ESC_INVENTORY_BUTTON_W,         ESC_INVENTORY_BUTTON_H) \
+    X(graybar_inventory_button,     GRAYBAR_INVENTORY_BUTTON_W,     GRAYBAR_INVENTORY_BUTTON_H) \
+    X(m_map_button,                 M_MAP_BUTTON_W,                 M_MAP_BUTTON_H) \
+    X(pg_banner_image,              PG_BANNER_IMAGE_W,              PG_BANNER_IMAGE_H) \
+    X(pad_map_button,               PAD_MAP_BUTTON_W,               PAD_MAP_BUTTON_H) \
+    X(pad_looting_button,           PAD_LOOTING_BUTTON_W,           PAD_LOOTING_BUTTON_H) \
+    X(pad_inventory_button,         PAD_INVENTORY_BUTTON_W,         PAD_INVENTORY_BUTTON_H) \
+    X(pad_tactical_button,          PAD_TACTICAL_BUTTON_W,          PAD_TACTICAL_BUTTON_H) \
+    X(spectate_image,               SPECTATE_IMAGE_W,               SPECTATE_IMAGE_H) \
+    X(map_game_button_2k,           MAP_GAME_BUTTON_2K_W,           MAP_GAME_BUTTON_2K_H) \
+    X(grenade_game_button_2k,       GRENADE_GAME_BUTTON_2K_W,       GRENADE_GAME_BUTTON_2K_H) \
+    X(esc_looting_button_2k,        ESC_LOOTING_BUTTON_2K_W,        ESC_LOOTING_BUTTON_2K_H) \
+    X(esc_inventory_button_2k,      ESC_INVENTORY_BUTTON_2K_W,      ESC_INVENTORY_BUTTON_2K_H) \
+    X(graybar_inventory_button_2k,  GRAYBAR_INVENTORY_BUTTON_2K_W,  GRAYBAR_INVENTORY_BUTTON_2K_H) \
+    X(m_map_button_2k,              M_MAP_BUTTON_2K_W,              M_MAP_BUTTON_2K_H) \
+    X(pg_banner_image_2k,           PG_BANNER_IMAGE_2K_W,           PG_BANNER_IMAGE_2K_H) \
+    X(pad_map_button_2k,            PAD_MAP_BUTTON_2K_W,            PAD_MAP_BUTTON_2K_H) \
+    X(pad_looting_button_2k,        PAD_LOOTING_BUTTON_2K_W,        PAD_LOOTING_BUTTON_2K_H) \
+    X(pad_inventory_button_2k,      PAD_INVENTORY_BUTTON_2K_W,      PAD_INVENTORY_BUTTON_2K_H) \
+    X(pad_tactical_button_2k,       PAD_TACTICAL_BUTTON_2K_W,       PAD_TACTICAL_BUTTON_2K_H) \
+    X(spectate_image_2k,            SPECTATE_IMAGE_2K_W,            SPECTATE_IMAGE_2K_H)
+
+SSD_KERNEL_AREAS(SSD_KERNEL)
+
+static const struct ssd_kernel ssd_kernels[] =
+{
+    SSD_KERNEL_AREAS(SSD_KERNEL_ENTRY)
+};
+
+#define SSD_KERNELS_NUM     (sizeof(ssd_kernels) / sizeof(ssd_kernels[0]))
+
 static void debug_step(apex_game_filter_context_t *filter)
 {
     filter->debug_counter++;
@@ -471,65 +812,342 @@ static bool debug_should_print(apex_game_filter_context_t *filter)
     return true;
 }
 
-static void fill_area(PIX *image, uint32_t *raw_image, unsigned width, unsigned height, const area_t *a, int xoff)
+static uint8_t clamp_channel(int32_t value)
+{
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+static const uint8_t *frame_region_pixel(const struct frame_view *frame, unsigned x, unsigned y)
+{
+    for (enum render_region rr = 0; rr < RENDER_REGIONS_NUM; rr++) {
+        const struct frame_region *region = &frame->regions[rr];
+
+        if (!region->data)
+            continue;
+
+        if (x < region->box.x || x >= region->box.x + region->box.w || y < region->box.y || y >= region->box.y + region->box.h)
+            continue;
+
+        return region->data + (y - region->box.y) * region->linesize + (x - region->box.x) * 4;
+    }
+
+    return NULL;
+}
+
+static void frame_get_rgb(const struct frame_view *frame, unsigned x, unsigned y, uint8_t *r, uint8_t *g, uint8_t *b)
+{
+    const uint8_t *p;
+    int32_t luma, u, v;
+
+    if (frame->flip)
+        y = frame->height - 1 - y;
+
+    switch (frame->format) {
+    case FRAME_RGBA:
+        p = frame->planes[0] + y * frame->linesize[0] + x * 4;
+        *r = p[0];
+        *g = p[1];
+        *b = p[2];
+        return;
+    case FRAME_BGRA:
+        p = frame->planes[0] + y * frame->linesize[0] + x * 4;
+        *r = p[2];
+        *g = p[1];
+        *b = p[0];
+        return;
+    case FRAME_REGIONS:
+        p = frame_region_pixel(frame, x, y);
+
+        if (!p) {
+            *r = *g = *b = 0;
+            return;
+        }
+
+        *r = p[0];
+        *g = p[1];
+        *b = p[2];
+        return;
+    case FRAME_NV12:
+        luma = frame->planes[0][y * frame->linesize[0] + x];
+        p = frame->planes[1] + (y / 2) * frame->linesize[1] + (x / 2) * 2;
+        u = p[0];
+        v = p[1];
+        break;
+    case FRAME_I420:
+        luma = frame->planes[0][y * frame->linesize[0] + x];
+        u = frame->planes[1][(y / 2) * frame->linesize[1] + (x / 2)];
+        v = frame->planes[2][(y / 2) * frame->linesize[2] + (x / 2)];
+        break;
+    default:
+        *r = *g = *b = 0;
+        return;
+    }
+
+    const int32_t (*m)[4] = frame->yuv_matrix;
+
+    *r = clamp_channel((m[0][0] * luma + m[0][1] * u + m[0][2] * v + m[0][3]) >> 16);
+    *g = clamp_channel((m[1][0] * luma + m[1][1] * u + m[1][2] * v + m[1][3]) >> 16);
+    *b = clamp_channel((m[2][0] * luma + m[2][1] * u + m[2][2] * v + m[2][3]) >> 16);
+}
+
+static void fill_area(PIX *image, const struct frame_view *frame, const area_t *a, int xoff)
 {
-    if (pixGetHeight(image) != height || pixGetWidth(image) != width)
-        pixSetResolution(image, width, height);
+    uint8_t r, g, b;
 
     for (unsigned x = a->x + xoff; x < (a->x + xoff + a->w); x++) {
         for (unsigned y = a->y; y < (a->y + a->h); y++) {
-            uint8_t *rgb = &raw_image[y * width + x];
-            uint8_t r = rgb[0];
-            uint8_t g = rgb[1];
-            uint8_t b = rgb[2];
+            frame_get_rgb(frame, x, y, &r, &g, &b);
             pixSetRGBPixel(image, x, y, r, g, b);
         }
     }
 }
 
-static float compare_psnr_value_of_area_with_offset(PIX *image, PIX *reference, const area_t *a, int xoff)
+static void fill_filter_area(apex_game_filter_context_t *filter, const area_t *a, int xoff)
+{
+    if (filter->areas_filled)
+        return;
+
+    fill_area(filter->image, &filter->frame, a, xoff);
+}
+
+/*
+ * the kernels are chosen again only when the areas change: new display,
+ * language or layout
+ */
+static void select_ssd_kernels(apex_game_filter_context_t *filter)
+{
+    if (filter->kernel_areas == filter->areas)
+        return;
+
+    filter->kernel_areas = filter->areas;
+
+    for (area_name_t an = 0; an < AREAS_NUM; an++) {
+        const area_t *a = &filter->areas[an];
+        struct ssd_kernel *k = &filter->area_kernels[an];
+
+        k->w = a->w;
+        k->h = a->h;
+        k->run = NULL;
+
+        for (size_t i = 0; i < SSD_KERNELS_NUM; i++) {
+            if (ssd_kernels[i].w == a->w && ssd_kernels[i].h == a->h) {
+                k->run = ssd_kernels[i].run;
+                break;
+            }
+        }
+    }
+}
+
+static uint64_t benchmark_ssd_kernels(apex_game_filter_context_t *filter, area_name_t an, const l_uint32 *image, uint32_t image_wpl, const uint8_t *planes, size_t plane_size, const area_t *a)
+{
+    struct ssd_benchmark *b = &filter->ssd_benchmarks[an];
+    uint64_t start = os_gettime_ns();
+    uint64_t generic = ssd_kernel_generic(image, image_wpl, planes, plane_size, a->w, a->h);
+    uint64_t middle = os_gettime_ns();
+    uint64_t specialized = filter->area_kernels[an].run(image, image_wpl, planes, plane_size);
+
+    b->generic_ns += middle - start;
+    b->specialized_ns += os_gettime_ns() - middle;
+    b->calls++;
+
+    if (specialized != generic)
+        b->mismatches++;
+
+    return specialized;
+}
+
+/*
+ * probing compares the areas of the other languages too, the kernel of the
+ * area is used only when the sizes agree
+ */
+static bool compare_ssd_value_of_area_with_offset(apex_game_filter_context_t *filter, area_name_t an, const struct reference_arena *arena, const struct reference_entry *entry, const area_t *a, int xoff, uint64_t *ssd)
+{
+    if (!entry || entry->w != a->w || entry->h != a->h)
+        return false;
+
+    const struct ssd_kernel *k = &filter->area_kernels[an];
+    uint32_t image_wpl = pixGetWpl(filter->image);
+    const l_uint32 *image = pixGetData(filter->image) + a->y * image_wpl + a->x + xoff;
+    const uint8_t *planes = reference_arena_plane(arena, entry, REFERENCE_RED);
+
+    if (!k->run || k->w != a->w || k->h != a->h)
+        *ssd = ssd_kernel_generic(image, image_wpl, planes, entry->plane_size, a->w, a->h);
+    else if (filter->debug_mode)
+        *ssd = benchmark_ssd_kernels(filter, an, image, image_wpl, planes, entry->plane_size, a);
+    else
+        *ssd = k->run(image, image_wpl, planes, entry->plane_size);
+
+    return true;
+}
+
+/*
+ * the pixels out of the mask of the reference are excluded from the
+ * comparison, see area-scores.h
+ */
+static float compare_ncc_value_of_area_with_offset(PIX *image, const struct reference_arena *arena, const struct reference_entry *entry, const area_t *a, int xoff)
+{
+    if (!entry || a->w != entry->w || a->h != entry->h)
+        return 0.0f;
+
+    uint32_t image_wpl = pixGetWpl(image);
+    const l_uint32 *pixels = pixGetData(image) + a->y * image_wpl + a->x + xoff;
+
+    return area_ncc(pixels, image_wpl, reference_arena_plane(arena, entry, REFERENCE_LUMA), reference_arena_plane(arena, entry, REFERENCE_MASK),
+                    a->w, a->h);
+}
+
+/*
+ * score distance from the threshold that makes a match (or a mismatch)
+ * decisive, see compare_area_with_offset()
+ */
+static const float decisive_margins[METRICS_NUM] =
+{
+    [METRIC_PSNR] =         6.0f,
+    [METRIC_LUMA_NCC] =     0.1f,
+    [METRIC_GLYPH_MASK] =   0.15f,
+};
+
+static void build_psnr_bounds(struct psnr_bounds *bounds, float threshold)
+{
+    for (int i = 0; i < PSNR_KNOTS; i++) {
+        double psnr = threshold + (PSNR_CONFIDENCE_MIN + (double)i / PSNR_CONFIDENCE_STEPS) * decisive_margins[METRIC_PSNR];
+        double knot = 3.0 * 255.0 * 255.0 * pow(10.0, -psnr / 10.0) * (1 << SSD_FRACTION_BITS);
+
+        bounds->knots[i] = knot < (double)SSD_KNOT_MAX ? (uint64_t)llround(knot) : SSD_KNOT_MAX;
+    }
+}
+
+/*
+ * largest squared error of an area that still matches
+ */
+static double psnr_max_ssd(const struct psnr_bounds *bounds, uint64_t pixels)
+{
+    return (double)(bounds->knots[PSNR_KNOT_THRESHOLD] * pixels) / (1 << SSD_FRACTION_BITS);
+}
+
+/*
+ * the confidence is exact at the knots and linear in the squared error
+ * between them, the match (above 0) and the decisive match (from 1) are
+ * decided on integers
+ */
+static float psnr_confidence(const struct psnr_bounds *bounds, uint64_t ssd, uint64_t pixels)
+{
+    uint64_t error = ssd << SSD_FRACTION_BITS;
+    int low = 0, high = PSNR_KNOTS - 1;
+
+    if (error > bounds->knots[0] * pixels)
+        return PSNR_CONFIDENCE_MIN;
+
+    /* last knot the error does not exceed */
+    while (low < high) {
+        int middle = (low + high + 1) / 2;
+
+        if (error <= bounds->knots[middle] * pixels)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+
+    float confidence = PSNR_CONFIDENCE_MIN + (float)low / PSNR_CONFIDENCE_STEPS;
+
+    if (low == PSNR_KNOTS - 1)
+        return confidence;
+
+    uint64_t upper = bounds->knots[low] * pixels, lower = bounds->knots[low + 1] * pixels;
+
+    return confidence + (float)((double)(upper - error) / (double)(upper - lower)) / PSNR_CONFIDENCE_STEPS;
+}
+
+/*
+ * -1 when the area has no glyph mask of its size, the area is then compared
+ * on its colours
+ */
+static float compare_glyph_value_of_area_with_offset(PIX *image, const struct glyph_mask *mask, const area_t *a, int xoff)
+{
+    if (!mask->w || mask->w != a->w || mask->h != a->h)
+        return -1.0f;
+
+    uint32_t image_wpl = pixGetWpl(image);
+    const l_uint32 *pixels = pixGetData(image) + a->y * image_wpl + a->x + xoff;
+
+    struct glyph_match match;
+
+    glyph_mask_match(mask, pixels, image_wpl, &match);
+
+    return glyph_mask_score(mask, &match);
+}
+
+/*
+ * returns the confidence of the match: the distance of the score from the
+ * threshold of the area measured in decisive margins of the metric. a positive
+ * confidence is a match, from 1 on the match is decisive and the secondary
+ * checks of the same HUD element can be skipped.
+ *
+ * reference is the index in the arena of the display, see layout_reference().
+ * the glyph masks are only built for the areas, not for the characters.
+ */
+static float compare_area_with_offset(apex_game_filter_context_t *filter, area_name_t an, const area_t *a, uint32_t reference, int xoff, float *score)
 {
-    BOX *box = boxCreate(a->x + xoff, a->y, a->w, a->h);
-    PIX *rectangle = pixClipRectangle(image, box, NULL);
+    const struct reference_arena *arena = &filter->layout->reference_arenas[filter->display];
+    const struct reference_entry *entry = reference_arena_entry(arena, reference);
+    uint64_t pixels = (uint64_t)a->w * a->h;
+    uint64_t ssd;
+
+    switch (filter->area_metrics[an]) {
+    case METRIC_LUMA_NCC:
+        *score = compare_ncc_value_of_area_with_offset(filter->image, arena, entry, a, xoff);
+        return (*score - filter->layout->thresholds[filter->display][an][METRIC_LUMA_NCC]) / decisive_margins[METRIC_LUMA_NCC];
+    case METRIC_GLYPH_MASK:
+        if (reference < AREAS_NUM) {
+            *score = compare_glyph_value_of_area_with_offset(filter->image, &filter->layout->glyph_masks[filter->display][reference], a, xoff);
+
+            if (*score >= 0.0f)
+                return (*score - filter->layout->thresholds[filter->display][an][METRIC_GLYPH_MASK]) / decisive_margins[METRIC_GLYPH_MASK];
+        }
+
+        /* fall through */
+    case METRIC_PSNR:
+    default:
+        *score = 0.0f;
 
-    float psnr;
-    pixGetPSNR(rectangle, reference, 1, &psnr);
+        if (!compare_ssd_value_of_area_with_offset(filter, an, arena, entry, a, xoff, &ssd))
+            return PSNR_CONFIDENCE_MIN;
 
-    boxDestroy(&box);
-    pixDestroy(&rectangle);
+        /* the score is only printed */
+        if (debug_should_print(filter))
+            *score = ssd_psnr(ssd, pixels);
 
-    return psnr;
+        return psnr_confidence(&filter->layout->psnr_bounds[filter->display][an], ssd, pixels);
+    }
 }
 
-static float compare_psnr_value_of_area(PIX *image, PIX *reference, const area_t *a)
+static void debug_filename(apex_game_filter_context_t *filter, char *filename, const char *prefix, const char *name)
 {
-    return compare_psnr_value_of_area_with_offset(image, reference, a, 0);
+    pthread_mutex_lock(&filter->debug_mutex);
+    snprintf(filename, DEBUG_SAVE_PATH_NAME_LEN, "%s/%s_%s.png", filter->debug_path, prefix, name);
+    pthread_mutex_unlock(&filter->debug_mutex);
 }
 
 static void save_ref_image(apex_game_filter_context_t *filter, area_name_t an)
 {
     char filename[DEBUG_SAVE_PATH_NAME_LEN];
+    PIX *reference = filter->layout->banner_references[filter->display][an];
 
-    const char *name = area_name_str[an];
+    if (!reference)
+        return;
 
-    snprintf(filename, DEBUG_SAVE_PATH_NAME_LEN, "%s\\ref_%s.png", DEBUG_SAVE_PATH, name);
+    debug_filename(filter, filename, "ref", area_name_str[an]);
 
-    pixWrite(filename, filter->banner_references[filter->display][an], IFF_PNG);
+    debug_writer_push(debug_writer, filename, reference, 0, 0, pixGetWidth(reference), pixGetHeight(reference));
 }
 
 static void save_image_area(apex_game_filter_context_t *filter, const area_t *a, const char *n)
 {
     char filename[DEBUG_SAVE_PATH_NAME_LEN];
 
-    BOX *box = boxCreate(a->x, a->y, a->w, a->h);
-    PIX *rectangle = pixClipRectangle(filter->image, box, NULL);
-
-    snprintf(filename, DEBUG_SAVE_PATH_NAME_LEN, "%s\\image_%s.png", DEBUG_SAVE_PATH, n);
+    debug_filename(filter, filename, "image", n);
 
-    pixWrite(filename, rectangle, IFF_PNG);
-
-    boxDestroy(&box);
-    pixDestroy(&rectangle);
+    debug_writer_push(debug_writer, filename, filter->image, a->x, a->y, a->w, a->h);
 }
 
 static void save_image(apex_game_filter_context_t *filter, area_name_t an)
@@ -545,6 +1163,11 @@ static const char *apex_game_filter_get_name(void *unused)
     return "Apex Game";
 }
 
+static const char *apex_game_async_filter_get_name(void *unused)
+{
+    return "Apex Game (Async)";
+}
+
 static void set_source_status(obs_weak_source_t *source, bool status)
 {
     obs_source_t *s = obs_weak_source_get_source(source);
@@ -554,92 +1177,620 @@ static void set_source_status(obs_weak_source_t *source, bool status)
     obs_source_release(s);
 }
 
-static bool get_area_status_withoffset(apex_game_filter_context_t *filter, area_name_t an, int xoff)
+static const char *hud_name(uint32_t banners)
 {
-    const area_t *a = &(filter->areas[an]);
-
-    fill_area(filter->image, filter->video_data, filter->width, filter->height, a, xoff);
-    float psnr = compare_psnr_value_of_area_with_offset(filter->image, filter->banner_references[filter->display][an], a, xoff);
-
-    bool match = psnr > PSNR_THRESHOLD_VALUE;
-
-    if (debug_should_print(filter))
-        binfo("%s: %f", area_name_str[an], psnr);
-
-    if (debug_should_save(filter)) {
-        save_image(filter, an);
-        save_ref_image(filter, an);
-    }
+    for (banner_position_t bp = 0; bp < BANNER_POSITION_NUM; bp++)
+        if (banners & (1 << bp))
+            return banner_position_str[bp];
 
-    return match;
+    return "none";
 }
 
-static bool get_area_status(apex_game_filter_context_t *filter, area_name_t an)
+static void set_hud_calldata(apex_game_filter_context_t *filter, calldata_t *cd, const struct hud_state *state)
 {
-    return get_area_status_withoffset(filter, an, 0);
+    calldata_set_ptr(cd, "source", filter->source);
+    calldata_set_int(cd, "banners", state->banners);
+    calldata_set_string(cd, "hud", hud_name(state->banners));
+    calldata_set_int(cd, "character", state->character);
+    calldata_set_string(cd, "character_name", state->character < CHARACTERS_NUM ? character_name_str[state->character] : "none");
+    calldata_set_int(cd, "spectate_color", state->spectate_color);
+    calldata_set_string(cd, "spectate_color_name", state->spectate_color < SPECTATE_COLORS_NUM ? spectate_color_str[state->spectate_color] : "none");
+    calldata_set_int(cd, "timestamp", (long long)state->timestamp_ns);
 }
 
-static void check_banner(apex_game_filter_context_t *filter, area_name_t an, banner_position_t bp)
+/*
+ * every analysed frame is published, not only the transitions, so that the
+ * readers can tell how fresh the state is
+ */
+static void export_result(apex_game_filter_context_t *filter, const struct hud_state *state)
 {
-    bool enable_target_source = get_area_status(filter, an);
+    struct hud_export_state export =
+    {
+        .frame = ++filter->export_frame,
+        .timestamp_ns = os_gettime_ns(),
+        .frame_timestamp_ns = state->timestamp_ns,
+        .banners = state->banners,
+        .character = state->character,
+        .spectate_color = state->spectate_color,
+        .display = filter->display,
+        .language = filter->language,
+        .input = filter->input,
+    };
+
+    for (banner_position_t bp = 0; bp < BANNER_POSITION_NUM && bp < HUD_EXPORT_BANNERS; bp++)
+        export.confidence[bp] = filter->result.confidence[bp];
 
-    set_source_status(filter->target_sources[bp], enable_target_source);
+    for (enum hud_counter hc = 0; hc < COUNTERS_NUM && hc < HUD_EXPORT_COUNTERS; hc++)
+        export.counter_changes[hc] = state->counter_changes[hc];
+
+    snprintf(export.hud, sizeof(export.hud), "%s", hud_name(state->banners));
+    snprintf(export.character_name, sizeof(export.character_name), "%s",
+             state->character < CHARACTERS_NUM ? character_name_str[state->character] : "none");
+    snprintf(export.spectate_color_name, sizeof(export.spectate_color_name), "%s",
+             state->spectate_color < SPECTATE_COLORS_NUM ? spectate_color_str[state->spectate_color] : "none");
+
+    hud_export_publish(filter->export, &export);
 }
 
-static character_name_t get_pg_showed(apex_game_filter_context_t *filter)
+/*
+ * the signal is emitted on the thread that toggles the sources, in the same
+ * frame where the transition was detected. the calldata lives on the stack.
+ */
+static bool publish_result(apex_game_filter_context_t *filter)
 {
-    character_name_t pg;
+    const struct detection_result *r = &filter->result;
+    struct hud_state state = { 0, r->character, r->spectate_color, r->timestamp_ns };
+    uint32_t counter_changes[COUNTERS_NUM];
 
-    fill_area(filter->image, filter->video_data, filter->width, filter->height, &(filter->areas[PG_BANNER_IMAGE]), 0);
+    for (banner_position_t bp = 0; bp < BANNER_POSITION_NUM; bp++)
+        if (r->banners[bp])
+            state.banners |= 1 << bp;
 
-    if (debug_should_save(filter)) {
-        save_image(filter, PG_BANNER_IMAGE);
-        save_ref_image(filter, PG_BANNER_IMAGE);
-    }
+    memcpy(state.counter_changes, r->counter_changes, sizeof(state.counter_changes));
 
-    for (pg = 0; pg < CHARACTERS_NUM; pg++) {
-        float psnr = compare_psnr_value_of_area(filter->image, filter->pg_references[filter->display][pg], &(filter->areas[PG_BANNER_IMAGE]));
+    pthread_mutex_lock(&filter->state_mutex);
 
-        if (debug_should_print(filter))
-            binfo("%s: %f", character_name_str[pg], psnr);
+    bool changed = state.banners != filter->state.banners || state.character != filter->state.character ||
+                   state.spectate_color != filter->state.spectate_color;
 
-        if (psnr > PSNR_THRESHOLD_VALUE)
-            break;
-    }
+    /*
+     * the counts come from the area watches of the filter that matched the
+     * frame, they start again from the counts of a new one
+     */
+    for (enum hud_counter hc = 0; hc < COUNTERS_NUM; hc++)
+        counter_changes[hc] = r->detector == filter->counters_detector && state.counter_changes[hc] > filter->state.counter_changes[hc]
+                                  ? state.counter_changes[hc] - filter->state.counter_changes[hc]
+                                  : 0;
 
-    return pg;
-}
+    filter->counters_detector = r->detector;
 
-#define BOX_START_X         290
-#define BOX_START_Y         790
-#define BOX_WIDTH           260
-#define BOX_HEIGHT          185
+    filter->state = state;
 
-#define BOX_START_2K_X      370
-#define BOX_START_2K_Y      1030
-#define BOX_WIDTH_2K        375
-#define BOX_HEIGHT_2K       275
+    if (filter->export)
+        export_result(filter, &state);
 
-#define MIN_LINE_LENGTH     75
-#define MIN_LINE_LENGTH_2K  100
+    pthread_mutex_unlock(&filter->state_mutex);
 
-#define GRAY_LINE_BANNER_DEFAULT_Y          926
-#define GRAY_LINE_BANNER_DEFAULT_X_END      450
-#define GRAY_LINE_BANNER_DEFAULT_DIFF       87
+    uint8_t stack[1024];
+    calldata_t cd;
 
-#define GRAY_LINE_BANNER_2K_DEFAULT_Y       1234
-#define GRAY_LINE_BANNER_2K_DEFAULT_X_END   617
-#define GRAY_LINE_BANNER_2K_DEFAULT_DIFF    116
+    for (enum hud_counter hc = 0; hc < COUNTERS_NUM; hc++) {
+        if (!counter_changes[hc])
+            continue;
 
-#define GRAY_POINT          150
-#define GRAY_MAX_DIFF       15
-#define GRAY_MIN            (GRAY_POINT - GRAY_MAX_DIFF)
-#define GRAY_MAX            (GRAY_POINT + GRAY_MAX_DIFF)
-#define GRAY_COMP_MAX_DIFF  8
+        calldata_init_fixed(&cd, stack, sizeof(stack));
+        calldata_set_ptr(&cd, "source", filter->source);
+        calldata_set_string(&cd, "counter", hud_counter_str[hc]);
+        calldata_set_int(&cd, "changes", state.counter_changes[hc]);
+        calldata_set_int(&cd, "timestamp", (long long)state.timestamp_ns);
 
-struct gray_line_searcher_ref
+        signal_handler_signal(obs_source_get_signal_handler(filter->source), "counter_changed", &cd);
+    }
+
+    if (!changed)
+        return false;
+
+    calldata_init_fixed(&cd, stack, sizeof(stack));
+    set_hud_calldata(filter, &cd, &state);
+
+    signal_handler_signal(obs_source_get_signal_handler(filter->source), "hud_changed", &cd);
+
+    return true;
+}
+
+static void get_hud_state_proc(void *data, calldata_t *cd)
 {
-    uint32_t box_start_x;
+    apex_game_filter_context_t *filter = data;
+
+    pthread_mutex_lock(&filter->state_mutex);
+    struct hud_state state = filter->state;
+    pthread_mutex_unlock(&filter->state_mutex);
+
+    set_hud_calldata(filter, cd, &state);
+}
+
+static void get_latency_proc(void *data, calldata_t *cd)
+{
+    apex_game_filter_context_t *filter = data;
+    char latency[8192];
+
+    latency_stats_format(&filter->latency_stats, latency, sizeof(latency));
+
+    if (calldata_bool(cd, "reset"))
+        latency_stats_reset(&filter->latency_stats);
+
+    calldata_set_string(cd, "latency", latency);
+}
+
+/*
+ * JSON object with the flips of every banner that reached the sources and the
+ * ones suppressed by the debounce
+ */
+static void get_debounce_proc(void *data, calldata_t *cd)
+{
+    apex_game_filter_context_t *filter = data;
+    char debounce[512];
+    size_t len = 0;
+
+    pthread_mutex_lock(&filter->state_mutex);
+
+    for (banner_position_t bp = 0; bp < BANNER_POSITION_NUM && len < sizeof(debounce); bp++) {
+        const struct banner_debouncer *d = &filter->debouncers[bp];
+
+        len += snprintf(debounce + len, sizeof(debounce) - len, "%s\"%s\":{\"flips\":%llu,\"suppressed\":%llu}", bp ? "," : "{",
+                        banner_position_str[bp], (unsigned long long)d->flips, (unsigned long long)banner_debouncer_suppressed(d));
+    }
+
+    pthread_mutex_unlock(&filter->state_mutex);
+
+    if (len < sizeof(debounce))
+        snprintf(debounce + len, sizeof(debounce) - len, "}");
+
+    calldata_set_string(cd, "debounce", debounce);
+}
+
+/*
+ * the sources follow the debounced banners, the published state too: the raw
+ * detection is only in the confidences and in the recordings
+ */
+static void debounce_result(apex_game_filter_context_t *filter)
+{
+    pthread_mutex_lock(&filter->state_mutex);
+
+    for (banner_position_t bp = 0; bp < BANNER_POSITION_NUM; bp++)
+        filter->result.banners[bp] = banner_debouncer_update(&filter->debouncers[bp], &filter->debounce, filter->result.banners[bp],
+                                                             filter->result.confidence[bp]);
+
+    pthread_mutex_unlock(&filter->state_mutex);
+
+    if (debug_should_print(filter)) {
+        uint64_t flips = 0, suppressed = 0;
+
+        for (banner_position_t bp = 0; bp < BANNER_POSITION_NUM; bp++) {
+            flips += filter->debouncers[bp].flips;
+            suppressed += banner_debouncer_suppressed(&filter->debouncers[bp]);
+        }
+
+        binfo("debounce: %llu flips, %llu suppressed", (unsigned long long)flips, (unsigned long long)suppressed);
+    }
+}
+
+static void apply_result(apex_game_filter_context_t *filter)
+{
+    struct latency_sample latency = filter->result.latency;
+
+    debounce_result(filter);
+
+    pthread_mutex_lock(&filter->target_mutex);
+
+    for (banner_position_t bp = 0; bp < BANNER_POSITION_NUM; bp++)
+        set_source_status(filter->target_sources[bp], filter->result.banners[bp]);
+
+    pthread_mutex_unlock(&filter->target_mutex);
+
+    latency.applied_ns = os_gettime_ns();
+    latency.applied_frame_ns = obs_get_video_frame_time();
+
+    bool transition = publish_result(filter);
+
+    latency_stats_add(&filter->latency_stats, &latency, transition, video_output_get_frame_time(obs_get_video()));
+}
+
+static float get_area_confidence_withoffset(apex_game_filter_context_t *filter, area_name_t an, int xoff)
+{
+    const area_t *a = &(filter->areas[an]);
+
+    fill_filter_area(filter, a, xoff);
+
+    float score;
+    float confidence = compare_area_with_offset(filter, an, a, an, xoff, &score);
+
+    if (debug_should_print(filter))
+        binfo("%s: %f (%s) confidence %.2f", area_name_str[an], score, match_metric_str[filter->area_metrics[an]], confidence);
+
+    if (debug_should_save(filter)) {
+        save_image(filter, an);
+        save_ref_image(filter, an);
+    }
+
+    return confidence;
+}
+
+static float get_area_confidence(apex_game_filter_context_t *filter, area_name_t an)
+{
+    return get_area_confidence_withoffset(filter, an, 0);
+}
+
+/*
+ * the area is looked for at its position and at the one moved by the offset
+ * of the layout, the second position is not checked when the first match is
+ * decisive
+ */
+static float get_area_confidence_anyoffset(apex_game_filter_context_t *filter, area_name_t an)
+{
+    float confidence = get_area_confidence(filter, an);
+
+    if (confidence >= 1.0f)
+        return confidence;
+
+    float offset_confidence = get_area_confidence_withoffset(filter, an, filter->layout->match_offsets[filter->display][an]);
+
+    return offset_confidence > confidence ? offset_confidence : confidence;
+}
+
+static void set_banner(apex_game_filter_context_t *filter, banner_position_t bp, float confidence)
+{
+    filter->result.banners[bp] = confidence > 0.0f;
+    filter->result.confidence[bp] = confidence;
+}
+
+static void check_banner(apex_game_filter_context_t *filter, area_name_t an, banner_position_t bp)
+{
+    set_banner(filter, bp, get_area_confidence(filter, an));
+}
+
+/*
+ * the tables are sized for the largest character banner of the display, see
+ * prepare_work_memory(). without them no character is ruled out.
+ */
+static void build_pg_prefilter(apex_game_filter_context_t *filter, const area_t *a)
+{
+    if (!filter->pg_prefilter.sat || prefilter_sat_size(a->w, a->h) > filter->pg_prefilter_size) {
+        filter->pg_prefilter.w = 0;
+        return;
+    }
+
+    prefilter_frame_build(&filter->pg_prefilter, pixGetData(filter->image), pixGetWpl(filter->image), a->x, a->y, a->w, a->h);
+
+    filter->prefilter_frames++;
+}
+
+/*
+ * returns the level of the cascade that ruled the character out, or -1, see
+ * area-prefilter.h
+ */
+static int reject_pg(apex_game_filter_context_t *filter, character_name_t pg)
+{
+    const struct prefilter_reference *ref = &filter->layout->pg_prefilters[filter->display][pg];
+    const struct psnr_bounds *bounds = &filter->layout->psnr_bounds[filter->display][PG_BANNER_IMAGE];
+    float threshold = filter->layout->thresholds[filter->display][PG_BANNER_IMAGE][METRIC_LUMA_NCC];
+    uint64_t pixels = (uint64_t)ref->w * ref->h;
+    float ncc_bound;
+    double ssd_bound;
+    int level;
+
+    if (filter->area_metrics[PG_BANNER_IMAGE] == METRIC_LUMA_NCC)
+        level = prefilter_reject_ncc(&filter->pg_prefilter, ref, threshold, &ncc_bound);
+    else
+        level = prefilter_reject_ssd(&filter->pg_prefilter, ref, psnr_max_ssd(bounds, pixels), &ssd_bound);
+
+    if (level < 0) {
+        filter->prefilter_compares++;
+        return -1;
+    }
+
+    filter->prefilter_rejects[level]++;
+
+    if (debug_should_print(filter))
+        binfo("%s: rejected at level %d, bound %f", character_name_str[pg], level,
+              filter->area_metrics[PG_BANNER_IMAGE] == METRIC_LUMA_NCC ? ncc_bound : ssd_psnr((uint64_t)ssd_bound, pixels));
+
+    return level;
+}
+
+/*
+ * the first character matching decisively is taken, otherwise the best of the
+ * characters that matched. the characters that cannot match are ruled out by
+ * the prefilter before the full comparison, the confidence is the best of the
+ * characters compared in full (-1 when all were ruled out): a bound only
+ * tells that the score is below the threshold, not by how much. a is the
+ * banner area, moved when the HUD drifts.
+ */
+static character_name_t get_pg_showed(apex_game_filter_context_t *filter, const area_t *a, float *confidence)
+{
+    character_name_t pg, best = CHARACTERS_NUM;
+    float best_confidence = 0.0f;
+
+    fill_filter_area(filter, a, 0);
+
+    if (debug_should_save(filter)) {
+        save_image_area(filter, a, area_name_str[PG_BANNER_IMAGE]);
+        save_ref_image(filter, PG_BANNER_IMAGE);
+    }
+
+    *confidence = -1.0f;
+
+    build_pg_prefilter(filter, a);
+
+    for (pg = 0; pg < CHARACTERS_NUM; pg++) {
+        float score;
+        float pg_confidence;
+
+        if (reject_pg(filter, pg) >= 0)
+            continue;
+
+        pg_confidence = compare_area_with_offset(filter, PG_BANNER_IMAGE, a, AREAS_NUM + pg, 0, &score);
+
+        if (debug_should_print(filter))
+            binfo("%s: %f (%s) confidence %.2f", character_name_str[pg], score, match_metric_str[filter->area_metrics[PG_BANNER_IMAGE]], pg_confidence);
+
+        if (pg_confidence > *confidence)
+            *confidence = pg_confidence;
+
+        if (pg_confidence > best_confidence) {
+            best = pg;
+            best_confidence = pg_confidence;
+
+            if (pg_confidence >= 1.0f)
+                break;
+        }
+    }
+
+    return best;
+}
+
+#define SPECTATE_MIN_PEAK           64
+#define SPECTATE_MIN_SATURATION     32
+
+/*
+ * a pixel belongs to the glyph when its brightest channel is above half of
+ * the brightest channel of the whole area, this makes the shape independent
+ * from the tint of the banner
+ */
+static bool spectate_glyph_pixel(uint32_t r, uint32_t g, uint32_t b, uint32_t peak)
+{
+    uint32_t v = r > g ? (r > b ? r : b) : (g > b ? g : b);
+
+    return (v * 2) > peak;
+}
+
+static uint32_t spectate_hue_bin(int r, int g, int b)
+{
+    int v = r > g ? (r > b ? r : b) : (g > b ? g : b);
+    int m = r < g ? (r < b ? r : b) : (g < b ? g : b);
+    int c = v - m;
+    int hue;
+
+    if (c == 0)
+        return SPECTATE_HUE_BINS;
+
+    if (v == r)
+        hue = 60 * (g - b) / c;
+    else if (v == g)
+        hue = 120 + 60 * (b - r) / c;
+    else
+        hue = 240 + 60 * (r - g) / c;
+
+    if (hue < 0)
+        hue += 360;
+
+    return (uint32_t)hue * SPECTATE_HUE_BINS / 360;
+}
+
+static uint32_t spectate_area_peak(PIX *image, const area_t *a)
+{
+    uint32_t r, g, b, peak = 0;
+
+    for (uint32_t y = a->y; y < (a->y + a->h); y++) {
+        for (uint32_t x = a->x; x < (a->x + a->w); x++) {
+            pixGetRGBPixel(image, x, y, &r, &g, &b);
+
+            uint32_t v = r > g ? (r > b ? r : b) : (g > b ? g : b);
+            if (v > peak)
+                peak = v;
+        }
+    }
+
+    return peak;
+}
+
+static uint32_t spectate_dominant_hue(PIX *image, const area_t *a, uint32_t peak)
+{
+    uint32_t r, g, b;
+    uint32_t histogram[SPECTATE_HUE_BINS] = { 0 };
+    uint32_t best = 0;
+
+    for (uint32_t y = a->y; y < (a->y + a->h); y++) {
+        for (uint32_t x = a->x; x < (a->x + a->w); x++) {
+            pixGetRGBPixel(image, x, y, &r, &g, &b);
+
+            if (!spectate_glyph_pixel(r, g, b, peak))
+                continue;
+
+            uint32_t v = r > g ? (r > b ? r : b) : (g > b ? g : b);
+            uint32_t m = r < g ? (r < b ? r : b) : (g < b ? g : b);
+            if ((v - m) < SPECTATE_MIN_SATURATION)
+                continue;
+
+            uint32_t bin = spectate_hue_bin(r, g, b);
+            if (bin < SPECTATE_HUE_BINS)
+                histogram[bin]++;
+        }
+    }
+
+    for (uint32_t bin = 1; bin < SPECTATE_HUE_BINS; bin++)
+        if (histogram[bin] > histogram[best])
+            best = bin;
+
+    return histogram[best] ? best : SPECTATE_HUE_BINS;
+}
+
+/*
+ * the four spectate references differ only by tint, build a single
+ * colour-neutral glyph mask (majority vote of the four references) and
+ * remember the dominant hue of each one to classify the team colour
+ */
+static void build_spectate_template(struct layout *l, enum display_resolution ds)
+{
+    struct spectate_template *st = &l->spectate_templates[ds];
+    PIX *references[SPECTATE_COLORS_NUM] =
+    {
+        [SPECTATE_RED] =    l->banner_references[ds][SPECTATE_IMAGE_RED],
+        [SPECTATE_GREEN] =  l->banner_references[ds][SPECTATE_IMAGE_GREEN],
+        [SPECTATE_ORANGE] = l->banner_references[ds][SPECTATE_IMAGE_ORANGE],
+        [SPECTATE_BLUE] =   l->banner_references[ds][SPECTATE_IMAGE_BLUE],
+    };
+
+    for (spectate_color_t sc = 0; sc < SPECTATE_COLORS_NUM; sc++)
+        if (!references[sc])
+            return;
+
+    st->w = pixGetWidth(references[SPECTATE_RED]);
+    st->h = pixGetHeight(references[SPECTATE_RED]);
+    st->mask = bzalloc(st->w * st->h);
+    st->glyph_pixels = 0;
+
+    for (spectate_color_t sc = 0; sc < SPECTATE_COLORS_NUM; sc++) {
+        area_t a = { 0, 0, st->w, st->h };
+        uint32_t r, g, b;
+        uint32_t peak = spectate_area_peak(references[sc], &a);
+
+        for (uint32_t y = 0; y < st->h; y++) {
+            for (uint32_t x = 0; x < st->w; x++) {
+                pixGetRGBPixel(references[sc], x, y, &r, &g, &b);
+
+                if (spectate_glyph_pixel(r, g, b, peak))
+                    st->mask[y * st->w + x]++;
+            }
+        }
+
+        st->hue_bin[sc] = spectate_dominant_hue(references[sc], &a, peak);
+    }
+
+    for (uint32_t i = 0; i < st->w * st->h; i++) {
+        st->mask[i] = st->mask[i] > (SPECTATE_COLORS_NUM / 2);
+        st->glyph_pixels += st->mask[i];
+    }
+}
+
+/*
+ * the confidence is measured on the glyph mismatches: 0 at the maximum
+ * allowed, decisive from half of it
+ */
+static spectate_color_t get_spectate_color(apex_game_filter_context_t *filter, float *confidence)
+{
+    const struct spectate_template *st = &filter->layout->spectate_templates[filter->display];
+    const area_t *a = &(filter->areas[SPECTATE_IMAGE_RED]);
+    uint32_t r, g, b, mismatches = 0;
+
+    *confidence = -1.0f;
+
+    fill_filter_area(filter, a, 0);
+
+    if (debug_should_save(filter)) {
+        save_image(filter, SPECTATE_IMAGE_RED);
+        save_ref_image(filter, SPECTATE_IMAGE_RED);
+    }
+
+    if (a->w != st->w || a->h != st->h)
+        return SPECTATE_COLORS_NUM;
+
+    uint32_t peak = spectate_area_peak(filter->image, a);
+
+    if (peak < SPECTATE_MIN_PEAK)
+        return SPECTATE_COLORS_NUM;
+
+    for (uint32_t y = 0; y < a->h; y++) {
+        for (uint32_t x = 0; x < a->w; x++) {
+            pixGetRGBPixel(filter->image, a->x + x, a->y + y, &r, &g, &b);
+
+            if (spectate_glyph_pixel(r, g, b, peak) != st->mask[y * a->w + x])
+                mismatches++;
+        }
+    }
+
+    if (debug_should_print(filter))
+        binfo("spectate mismatches: %d/%d", mismatches, st->glyph_pixels);
+
+    float allowed = st->glyph_pixels / 4.0f;
+
+    if (allowed > 0.0f)
+        *confidence = (allowed - mismatches) / (allowed / 2.0f);
+
+    if ((mismatches * 4) > st->glyph_pixels)
+        return SPECTATE_COLORS_NUM;
+
+    uint32_t hue = spectate_dominant_hue(filter->image, a, peak);
+
+    if (hue == SPECTATE_HUE_BINS) {
+        *confidence = -1.0f;
+        return SPECTATE_COLORS_NUM;
+    }
+
+    spectate_color_t color = SPECTATE_COLORS_NUM;
+    uint32_t best_distance = SPECTATE_HUE_BINS;
+
+    for (spectate_color_t sc = 0; sc < SPECTATE_COLORS_NUM; sc++) {
+        uint32_t distance = hue > st->hue_bin[sc] ? hue - st->hue_bin[sc] : st->hue_bin[sc] - hue;
+
+        if (distance > SPECTATE_HUE_BINS / 2)
+            distance = SPECTATE_HUE_BINS - distance;
+
+        if (distance < best_distance) {
+            best_distance = distance;
+            color = sc;
+        }
+    }
+
+    if (debug_should_print(filter))
+        binfo("spectate color: %s", color != SPECTATE_COLORS_NUM ? spectate_color_str[color] : "none");
+
+    return color;
+}
+
+#define BOX_START_X         290
+#define BOX_START_Y         790
+#define BOX_WIDTH           260
+#define BOX_HEIGHT          185
+
+#define BOX_START_2K_X      370
+#define BOX_START_2K_Y      1030
+#define BOX_WIDTH_2K        375
+#define BOX_HEIGHT_2K       275
+
+#define MIN_LINE_LENGTH     75
+#define MIN_LINE_LENGTH_2K  100
+
+#define TRACK_WINDOW        6
+#define TRACK_WINDOW_2K     8
+
+#define GRAY_LINE_BANNER_DEFAULT_Y          926
+#define GRAY_LINE_BANNER_DEFAULT_X_END      450
+#define GRAY_LINE_BANNER_DEFAULT_DIFF       87
+
+#define GRAY_LINE_BANNER_2K_DEFAULT_Y       1234
+#define GRAY_LINE_BANNER_2K_DEFAULT_X_END   617
+#define GRAY_LINE_BANNER_2K_DEFAULT_DIFF    116
+
+#define GRAY_POINT          150
+#define GRAY_MAX_DIFF       15
+#define GRAY_MIN            (GRAY_POINT - GRAY_MAX_DIFF)
+#define GRAY_MAX            (GRAY_POINT + GRAY_MAX_DIFF)
+#define GRAY_COMP_MAX_DIFF  8
+
+struct gray_line_searcher_ref
+{
+    uint32_t box_start_x;
     uint32_t box_start_y;
     uint32_t box_witdh;
     uint32_t box_height;
@@ -647,12 +1798,13 @@ struct gray_line_searcher_ref
     uint32_t default_grayline_y;
     uint32_t default_grayline_x_end;
     uint32_t default_grayline_diff;
+    uint32_t track_window;
 };
 
 const struct gray_line_searcher_ref line_searches[DISPLAY_RESOLUTIONS] =
 {
-    [DISPLAY_1080P] =   { BOX_START_X,      BOX_START_Y,    BOX_WIDTH,      BOX_HEIGHT,     MIN_LINE_LENGTH,    GRAY_LINE_BANNER_DEFAULT_Y,     GRAY_LINE_BANNER_DEFAULT_X_END,     GRAY_LINE_BANNER_DEFAULT_DIFF       },
-    [DISPLAY_2K] =      { BOX_START_2K_X,   BOX_START_2K_Y, BOX_WIDTH_2K,   BOX_HEIGHT_2K,  MIN_LINE_LENGTH_2K, GRAY_LINE_BANNER_2K_DEFAULT_Y,  GRAY_LINE_BANNER_2K_DEFAULT_X_END,  GRAY_LINE_BANNER_2K_DEFAULT_DIFF    },
+    [DISPLAY_1080P] =   { BOX_START_X,      BOX_START_Y,    BOX_WIDTH,      BOX_HEIGHT,     MIN_LINE_LENGTH,    GRAY_LINE_BANNER_DEFAULT_Y,     GRAY_LINE_BANNER_DEFAULT_X_END,     GRAY_LINE_BANNER_DEFAULT_DIFF,      TRACK_WINDOW    },
+    [DISPLAY_2K] =      { BOX_START_2K_X,   BOX_START_2K_Y, BOX_WIDTH_2K,   BOX_HEIGHT_2K,  MIN_LINE_LENGTH_2K, GRAY_LINE_BANNER_2K_DEFAULT_Y,  GRAY_LINE_BANNER_2K_DEFAULT_X_END,  GRAY_LINE_BANNER_2K_DEFAULT_DIFF,   TRACK_WINDOW_2K },
 };
 
 static bool check_rgb(int r, int g, int b)
@@ -698,7 +1850,7 @@ static bool find_banner_gray_lines(apex_game_filter_context_t *filter, struct gr
     lines[0].found = false;
     lines[1].found = false;
 
-    fill_area(filter->image, filter->video_data, filter->width, filter->height, &a, 0);
+    fill_area(filter->image, &filter->frame, &a, 0);
 
     x = ls->box_start_x;
     y = ls->box_start_y + ls->box_height;
@@ -760,180 +1912,1802 @@ static bool find_banner_gray_lines(apex_game_filter_context_t *filter, struct gr
     return false;
 }
 
-int match_offsets[DISPLAY_RESOLUTIONS][AREAS_NUM] =
+static uint32_t gray_line_length(apex_game_filter_context_t *filter, const struct gray_line_searcher_ref *ls, uint32_t y, uint32_t *end_x)
 {
-    [DISPLAY_1080P] =
-    {
-        [M_MAP_BUTTON] =            -2,
-        [PAD_MAP_BUTTON] =          -2,
-        [PAD_LOOTING_BUTTON] =      -8,
-        [PAD_INVENTORY_BUTTON] =    -8,
-        [ESC_INVENTORY_BUTTON] =    -8,
-        [ESC_LOOTING_BUTTON] =      -8,
-    },
-    [DISPLAY_2K] =
-    {
-        [M_MAP_BUTTON] =            -3,
-        [PAD_MAP_BUTTON] =          -3,
-        [PAD_LOOTING_BUTTON] =      -11,
-        [PAD_INVENTORY_BUTTON] =    -11,
-        [ESC_INVENTORY_BUTTON] =    -11,
-        [ESC_LOOTING_BUTTON] =      -11,
-    },
-};
+    uint32_t x, r, g, b, count = 0;
 
-static void match_mk(apex_game_filter_context_t *filter)
-{
-    /*
-     * if the area of interest matches the reference image we are
-     * 100% sure that we can move to that scene
-     */
-    bool esc_looting_button = get_area_status(filter, ESC_LOOTING_BUTTON);
-    bool esc_looting_button_offset = get_area_status_withoffset(filter, ESC_LOOTING_BUTTON, match_offsets[filter->display][ESC_LOOTING_BUTTON]);
-    bool activate_looting = esc_looting_button || esc_looting_button_offset;
+    for (x = ls->box_start_x; x < (ls->box_start_x + ls->box_witdh); x++) {
+        pixGetRGBPixel(filter->image, x, y, &r, &g, &b);
 
-    set_source_status(filter->target_sources[BANNER_LOOTING], activate_looting);
+        if (!check_rgb(r, g, b))
+            break;
 
-    /*
-     * checking map in control game mode moves the M button a little bit
-     * with respect to all other game modes
-     */
-    bool map_button = get_area_status(filter, M_MAP_BUTTON);
-    bool map_button_offset = get_area_status_withoffset(filter, M_MAP_BUTTON, match_offsets[filter->display][M_MAP_BUTTON]);
-    bool activate_map = map_button || map_button_offset;
+        count++;
+    }
 
-    set_source_status(filter->target_sources[BANNER_MAP], activate_map);
+    *end_x = x;
 
-    /*
+    return count;
+}
+
+/*
+ * the pad inventory HUD drifts a few pixels when the analog joystick is moved,
+ * instead of scanning the whole box every frame the displacement found in the
+ * previous frame is used as a seed and only a small window of rows around it
+ * is checked, starting from the predicted position and moving outwards.
+ * if the line pair is lost the full scan is performed again to re-lock.
+ */
+static bool track_banner_gray_lines(apex_game_filter_context_t *filter, struct gray_line lines[2])
+{
+    const struct gray_line_searcher_ref *ls = &line_searches[filter->display];
+    struct hud_tracker *t = &filter->inventory_tracker;
+
+    lines[0].found = false;
+    lines[1].found = false;
+
+    if (t->locked) {
+        int diff = ls->default_grayline_diff;
+        int window = ls->track_window;
+        int box_top = ls->box_start_y;
+        int box_bottom = ls->box_start_y + ls->box_height;
+        int predicted_y = ls->default_grayline_y + t->dy;
+
+        int top = predicted_y - diff - window;
+        int bottom = predicted_y + window;
+
+        if (top < box_top)
+            top = box_top;
+
+        if (bottom > box_bottom - 1)
+            bottom = box_bottom - 1;
+
+        if (top < bottom) {
+            area_t a =
+            {
+                .x = ls->box_start_x,
+                .y = top,
+                .w = ls->box_witdh,
+                .h = bottom - top + 1
+            };
+
+            fill_area(filter->image, &filter->frame, &a, 0);
+        }
+
+        for (int step = 0; step <= 2 * window; step++) {
+            int delta = (step & 1) ? (step + 1) / 2 : -(step / 2);
+            int y = predicted_y + delta;
+            uint32_t end_x_first, end_x_second;
+
+            if (y > bottom || (y - diff) < top)
+                continue;
+
+            uint32_t count_first = gray_line_length(filter, ls, y, &end_x_first);
+            if (count_first <= ls->min_line_length)
+                continue;
+
+            uint32_t count_second = gray_line_length(filter, ls, y - diff, &end_x_second);
+            if (count_second <= ls->min_line_length)
+                continue;
+
+            lines[0].pixel_count = count_first;
+            lines[0].end_x = end_x_first;
+            lines[0].y = y;
+            lines[0].found = true;
+
+            lines[1].pixel_count = count_second;
+            lines[1].end_x = end_x_second;
+            lines[1].y = y - diff;
+            lines[1].found = true;
+
+            t->dx = lines[0].end_x - ls->default_grayline_x_end;
+            t->dy = lines[0].y - ls->default_grayline_y;
+
+            if (debug_should_print(filter))
+                binfo("inventory tracked dx: %d dy: %d", t->dx, t->dy);
+
+            return true;
+        }
+
+        t->locked = false;
+    }
+
+    if (!find_banner_gray_lines(filter, lines))
+        return false;
+
+    t->dx = lines[0].end_x - ls->default_grayline_x_end;
+    t->dy = lines[0].y - ls->default_grayline_y;
+    t->locked = true;
+
+    if (debug_should_print(filter))
+        binfo("inventory locked dx: %d dy: %d", t->dx, t->dy);
+
+    return true;
+}
+
+static const int32_t default_match_offsets[DISPLAY_RESOLUTIONS][AREAS_NUM] =
+{
+    [DISPLAY_1080P] =
+    {
+        [M_MAP_BUTTON] =            -2,
+        [PAD_MAP_BUTTON] =          -2,
+        [PAD_LOOTING_BUTTON] =      -8,
+        [PAD_INVENTORY_BUTTON] =    -8,
+        [ESC_INVENTORY_BUTTON] =    -8,
+        [ESC_LOOTING_BUTTON] =      -8,
+    },
+    [DISPLAY_2K] =
+    {
+        [M_MAP_BUTTON] =            -3,
+        [PAD_MAP_BUTTON] =          -3,
+        [PAD_LOOTING_BUTTON] =      -11,
+        [PAD_INVENTORY_BUTTON] =    -11,
+        [ESC_INVENTORY_BUTTON] =    -11,
+        [ESC_LOOTING_BUTTON] =      -11,
+    },
+};
+
+static void detect_mk_looting(apex_game_filter_context_t *filter)
+{
+    /*
+     * if the area of interest matches the reference image we are
+     * 100% sure that we can move to that scene
+     */
+    float esc_looting_button = get_area_confidence_anyoffset(filter, ESC_LOOTING_BUTTON);
+
+    set_banner(filter, BANNER_LOOTING, esc_looting_button);
+}
+
+static void detect_mk_map(apex_game_filter_context_t *filter)
+{
+    /*
+     * checking map in control game mode moves the M button a little bit
+     * with respect to all other game modes
+     */
+    float map_button = get_area_confidence_anyoffset(filter, M_MAP_BUTTON);
+
+    set_banner(filter, BANNER_MAP, map_button);
+}
+
+static void detect_mk_inventory(apex_game_filter_context_t *filter)
+{
+    /*
      * if inventory ESC button is found a further check must performed if inventory tab
      * is selected, otherwise in the other tabs player banner is not showed
      */
-    bool esc_inventory_button = get_area_status(filter, ESC_INVENTORY_BUTTON);
-    bool esc_inventory_button_offset = get_area_status_withoffset(filter, ESC_INVENTORY_BUTTON, match_offsets[filter->display][ESC_INVENTORY_BUTTON]);
-    bool activate_inventory = esc_inventory_button || esc_inventory_button_offset;
-    if (activate_inventory) {
-        if (get_area_status(filter, GRAYBAR_INVENTORY_BUTTON))
-            set_source_status(filter->target_sources[BANNER_INVENTORY], true);
-        else
-            set_source_status(filter->target_sources[BANNER_INVENTORY], false);
+    float esc_inventory_button = get_area_confidence_anyoffset(filter, ESC_INVENTORY_BUTTON);
+
+    if (esc_inventory_button > 0.0f) {
+        float graybar_inventory = get_area_confidence(filter, GRAYBAR_INVENTORY_BUTTON);
+
+        set_banner(filter, BANNER_INVENTORY, graybar_inventory < esc_inventory_button ? graybar_inventory : esc_inventory_button);
     } else {
-        set_source_status(filter->target_sources[BANNER_INVENTORY], false);
+        set_banner(filter, BANNER_INVENTORY, esc_inventory_button);
     }
+}
 
+static void detect_mk_game(apex_game_filter_context_t *filter)
+{
     /*
      * in game matching is a little bit more difficult since when pg info button was removed
      * first we try to identify the pg in the bottom left part of the screen, this should cover the
      * majority of occurreciens.
      * in some situations the pg is not recognizable (ie. when player receives damage the pg image
-     * pulses with a red color making recognition unreliable), therefore we use the M button top
-     * left or the G under grenades slot.
+     * pulses with a red color making recognition unreliable with psnr, the ncc metric is not
+     * affected), therefore we use the M button top left or the G under grenades slot,
+     * the second one only when the first is not decisive.
      */
-    bool enable_banner_game = false;
+    float game;
 
-    character_name_t pg = get_pg_showed(filter);
+    character_name_t pg = get_pg_showed(filter, &(filter->areas[PG_BANNER_IMAGE]), &game);
 
-    if (pg != CHARACTERS_NUM) {
-        enable_banner_game = true;
-    } else {
-        bool map_game = get_area_status(filter, MAP_GAME_BUTTON);
-        bool grenade_game = get_area_status(filter, GRENADE_GAME_BUTTON);
+    filter->result.character = pg;
+
+    if (pg == CHARACTERS_NUM) {
+        game = get_area_confidence(filter, MAP_GAME_BUTTON);
 
-        enable_banner_game = map_game || grenade_game;
+        if (game < 1.0f) {
+            float grenade_game = get_area_confidence(filter, GRENADE_GAME_BUTTON);
+
+            if (grenade_game > game)
+                game = grenade_game;
+        }
     }
 
-    set_source_status(filter->target_sources[BANNER_GAME], enable_banner_game);
+    set_banner(filter, BANNER_GAME, game);
+}
 
+static void detect_spectate(apex_game_filter_context_t *filter)
+{
     /*
      * spectate matching is done by checking a portion of the bottom center frame
      * with the name of the spectating person.
      * there are 4 different colors depending on who is spectating: red: enemy,
-     * orange/blue/green: team mate.
+     * orange/blue/green: team mate. the shape is checked once against a
+     * colour-neutral mask and the colour is classified from the hue.
      */
-    bool spectate_red = get_area_status(filter, SPECTATE_IMAGE_RED);
-    bool spectate_green = get_area_status(filter, SPECTATE_IMAGE_GREEN);
-    bool spectate_orange = get_area_status(filter, SPECTATE_IMAGE_ORANGE);
-    bool spectate_blue = get_area_status(filter, SPECTATE_IMAGE_BLUE);
-    bool activate_specatate = spectate_red || spectate_green || spectate_orange || spectate_blue;
+    float spectate;
 
-    set_source_status(filter->target_sources[BANNER_SPECTATE], activate_specatate);
+    filter->result.spectate_color = get_spectate_color(filter, &spectate);
+    bool activate_specatate = filter->result.spectate_color != SPECTATE_COLORS_NUM;
+
+    filter->result.banners[BANNER_SPECTATE] = activate_specatate;
+    filter->result.confidence[BANNER_SPECTATE] = spectate;
 }
 
-static void match_ps4pad(apex_game_filter_context_t *filter)
+static void detect_pad_map(apex_game_filter_context_t *filter)
 {
     /*
      * checking map in control game mode moves the M button a little bit
      * with respect to all other game modes
      */
-    bool pad_map = get_area_status(filter, PAD_MAP_BUTTON);
-    bool pad_map_offset = get_area_status_withoffset(filter, PAD_MAP_BUTTON, match_offsets[filter->display][PAD_MAP_BUTTON]);
-    bool activate_map = pad_map || pad_map_offset;
+    float pad_map = get_area_confidence_anyoffset(filter, PAD_MAP_BUTTON);
 
-    set_source_status(filter->target_sources[BANNER_MAP], activate_map);
+    set_banner(filter, BANNER_MAP, pad_map);
+}
 
+static void detect_pad_looting(apex_game_filter_context_t *filter)
+{
     /*
      * there's a funny behaviour if you use m&k and pad at the same time,
      * the absolute position of the button moves by 8 pixels wheter or not
      * you move mouse, handle this case by trying to recognize the reference
      * image twice considering that offset
      */
-    bool pad_looting = get_area_status(filter, PAD_LOOTING_BUTTON);
-    bool pad_looting_offset = get_area_status_withoffset(filter, PAD_LOOTING_BUTTON, match_offsets[filter->display][PAD_LOOTING_BUTTON]);
-    bool activate_looting = pad_looting || pad_looting_offset;
+    float pad_looting = get_area_confidence_anyoffset(filter, PAD_LOOTING_BUTTON);
 
-    set_source_status(filter->target_sources[BANNER_LOOTING], activate_looting);
+    set_banner(filter, BANNER_LOOTING, pad_looting);
+}
 
+static void detect_pad_inventory(apex_game_filter_context_t *filter)
+{
     /*
      * inventory for pad is difficult, the absolute position of the pg HUD moves when
-     * analog joystick is moved making recognition of this HUD not perfect
-     * as for now recognize only the inventory button, a much complex analysis is
-     * necessary to move the source in the correct position
+     * analog joystick is moved making recognition of this HUD not perfect.
+     * here only the button is recognized, the gray lines of the banner are
+     * tracked afterwards by confirm_pad_inventory
      */
-    bool pad_inventory = get_area_status(filter, PAD_INVENTORY_BUTTON);
-    bool pad_inventory_offset = get_area_status_withoffset(filter, PAD_INVENTORY_BUTTON, match_offsets[filter->display][PAD_INVENTORY_BUTTON]);
-    bool activate_inventory = pad_inventory || pad_inventory_offset;
+    float pad_inventory = get_area_confidence_anyoffset(filter, PAD_INVENTORY_BUTTON);
+
+    set_banner(filter, BANNER_INVENTORY, pad_inventory);
+}
+
+/*
+ * the character banner drifts with the gray lines, it is looked for at the
+ * tracked position when it was not found at the default one
+ */
+static void detect_pad_inventory_pg(apex_game_filter_context_t *filter)
+{
+    const struct hud_tracker *t = &filter->inventory_tracker;
+    const area_t *default_area = &(filter->areas[PG_BANNER_IMAGE]);
+    float confidence;
 
-    if (activate_inventory) {
+    if (filter->result.character != CHARACTERS_NUM || (!t->dx && !t->dy))
+        return;
+
+    area_t a = *default_area;
+    int x = (int)a.x + t->dx;
+    int y = (int)a.y + t->dy;
+
+    if (x < 0 || y < 0 || (uint32_t)x + a.w > filter->width || (uint32_t)y + a.h > filter->height)
+        return;
+
+    a.x = x;
+    a.y = y;
+
+    filter->result.character = get_pg_showed(filter, &a, &confidence);
+}
+
+static void confirm_pad_inventory(apex_game_filter_context_t *filter)
+{
+    /*
+     * the gray lines of the banner are tracked frame by frame, the displacement
+     * with respect to the default position is kept in the inventory tracker
+     */
+    if (filter->result.banners[BANNER_INVENTORY]) {
         struct gray_line lines[2];
-        bool gray_line_found = find_banner_gray_lines(filter, lines);
+        bool gray_line_found = track_banner_gray_lines(filter, lines);
+
+        if (!gray_line_found)
+            set_banner(filter, BANNER_INVENTORY, -1.0f);
+        else
+            detect_pad_inventory_pg(filter);
+    }
+}
+
+static void detect_pad_game(apex_game_filter_context_t *filter)
+{
+    /*
+     * in game matching is a little bit more difficult since when pg info button was removed
+     * first we try to identify the pg in the bottom left part of the screen, this should cover the
+     * majority of occurreciens.
+     * in some situations the pg is not recognizable (ie. when player receives damage the pg image
+     * pulses with a red color making recognition unreliable with psnr, the ncc metric is not
+     * affected), therefore we use the L1 button of the tactical ability
+     */
+    float game;
+
+    character_name_t pg = get_pg_showed(filter, &(filter->areas[PG_BANNER_IMAGE]), &game);
+
+    filter->result.character = pg;
+
+    if (pg == CHARACTERS_NUM)
+        game = get_area_confidence(filter, PAD_TACTICAL_BUTTON);
+
+    set_banner(filter, BANNER_GAME, game);
+}
+
+#define WATCH_TOLERANCE         48
+#define WATCH_SETTLE_FRAMES     3
+
+/*
+ * the area is sampled straight from the frame on the grid of area-watch.h,
+ * it is copied in the image only when its detector compares it
+ */
+static enum area_watch_event watch_area(apex_game_filter_context_t *filter, struct area_watch *watch, const area_t *a)
+{
+    uint32_t samples[AREA_WATCH_SAMPLES];
+    uint32_t columns, rows, count = 0;
+    uint8_t r, g, b;
+
+    area_watch_grid(a->w, a->h, &columns, &rows);
+
+    for (uint32_t row = 0; row < rows; row++) {
+        for (uint32_t column = 0; column < columns; column++) {
+            frame_get_rgb(&filter->frame, a->x + column * a->w / columns, a->y + row * a->h / rows, &r, &g, &b);
+
+            samples[count++] = ((uint32_t)r << 24) | ((uint32_t)g << 16) | ((uint32_t)b << 8);
+        }
+    }
+
+    return area_watch_update(watch, samples, count, WATCH_TOLERANCE, WATCH_SETTLE_FRAMES);
+}
+
+/*
+ * the counters are on the screen only in game and seldom change: their areas
+ * are watched on the game frames. they are not read, every new content after
+ * the first one is a change of their value. the areas the layout does not
+ * place are skipped.
+ */
+static void detect_counters(apex_game_filter_context_t *filter)
+{
+    if (!filter->result.banners[BANNER_GAME])
+        return;
+
+    for (enum hud_counter hc = 0; hc < COUNTERS_NUM; hc++) {
+        const area_t *a = &(filter->areas[counter_areas[hc]]);
+        struct area_watch *watch = &filter->counter_watches[hc];
+
+        if (!a->w || !a->h || watch_area(filter, watch, a) != AREA_WATCH_NEW)
+            continue;
+
+        filter->watch_evaluations++;
+
+        if (watch->news < 2)
+            continue;
+
+        filter->result.counter_changes[hc]++;
+
+        if (debug_should_print(filter))
+            binfo("%s changed (%u)", hud_counter_str[hc], filter->result.counter_changes[hc]);
+    }
+}
+
+static void log_area_watches(apex_game_filter_context_t *filter)
+{
+    uint64_t frames = 0, changes = 0;
+
+    for (enum hud_counter hc = 0; hc < COUNTERS_NUM; hc++) {
+        frames += filter->counter_watches[hc].frames;
+        changes += filter->counter_watches[hc].changes;
+    }
+
+    if (!frames)
+        return;
+
+    binfo("counters: %llu area samplings, %llu changes, %llu settled", (unsigned long long)frames, (unsigned long long)changes,
+          (unsigned long long)filter->watch_evaluations);
+}
+
+typedef void (*detector_t)(apex_game_filter_context_t *filter);
+
+static const detector_t mk_detectors[] =
+{
+    detect_mk_looting,
+    detect_mk_map,
+    detect_mk_inventory,
+    detect_mk_game,
+    detect_spectate,
+};
+
+static const detector_t pad_detectors[] =
+{
+    detect_pad_map,
+    detect_pad_looting,
+    detect_pad_inventory,
+    detect_pad_game,
+    detect_spectate,
+};
+
+/*
+ * areas of detect_counters(), that runs after the other detectors
+ */
+static const bool watched_areas[AREAS_NUM] =
+{
+    [SQUADS_LEFT_IMAGE] =   true,
+    [KILL_COUNT_IMAGE] =    true,
+};
+
+/*
+ * some areas overlap (ie. the ESC inventory and the M map buttons), before
+ * fanning out all of them are copied in the image so that the detectors
+ * running in parallel only read the shared image
+ */
+static void fill_all_areas(apex_game_filter_context_t *filter)
+{
+    for (area_name_t an = 0; an < AREAS_NUM; an++) {
+        if (watched_areas[an])
+            continue;
+
+        int xoff = filter->layout->match_offsets[filter->display][an];
+
+        fill_area(filter->image, &filter->frame, &(filter->areas[an]), 0);
+
+        if (xoff)
+            fill_area(filter->image, &filter->frame, &(filter->areas[an]), xoff);
+    }
+}
+
+static void detector_job(void *param)
+{
+    struct detector_job *job = param;
+
+    job->detect(job->filter);
+}
+
+/*
+ * every detector writes only its own fields of the result, running them in
+ * parallel gives the same result of running them one after the other
+ */
+static void run_detectors(apex_game_filter_context_t *filter, const detector_t *detectors, size_t count)
+{
+    if (!filter->parallel || !detection_pool || count > DETECTORS_MAX) {
+        for (size_t i = 0; i < count; i++)
+            detectors[i](filter);
+
+        return;
+    }
+
+    fill_all_areas(filter);
+
+    filter->areas_filled = true;
+
+    for (size_t i = 0; i < count; i++) {
+        filter->detector_jobs[i].filter = filter;
+        filter->detector_jobs[i].detect = detectors[i];
+
+        worker_pool_submit(detection_pool, &filter->detectors, detector_job, &filter->detector_jobs[i]);
+    }
+
+    worker_group_wait(detection_pool, &filter->detectors);
+
+    filter->areas_filled = false;
+}
+
+static void match_mk(apex_game_filter_context_t *filter)
+{
+    run_detectors(filter, mk_detectors, sizeof(mk_detectors) / sizeof(mk_detectors[0]));
+
+    detect_counters(filter);
+}
+
+static void match_ps4pad(apex_game_filter_context_t *filter)
+{
+    run_detectors(filter, pad_detectors, sizeof(pad_detectors) / sizeof(pad_detectors[0]));
+
+    confirm_pad_inventory(filter);
+    detect_counters(filter);
+}
+
+static const area_t *get_default_areas(enum display_resolution display, enum game_language language)
+{
+    if (display == DISPLAY_1080P) {
+        if (language == LANGUAGE_EN)
+            return areas_1080p_en;
+        else if (language == LANGUAGE_IT)
+            return areas_1080p_it;
+        else if (language == LANGUAGE_ZH)
+            return areas_1080p_zh;
+    } else if (display == DISPLAY_2K) {
+        if (language == LANGUAGE_EN)
+            return areas_2k_en;
+        else if (language == LANGUAGE_IT)
+            return areas_2k_it;
+        else if (language == LANGUAGE_ZH)
+            return areas_2k_zh;
+    }
+
+    return NULL;
+}
+
+static const area_t *get_areas(const struct layout *l, enum display_resolution display, enum game_language language)
+{
+    return l->areas[display][language];
+}
+
+static bool probe_area(apex_game_filter_context_t *filter, const area_t *areas, area_name_t an, int xoff)
+{
+    const area_t *a = &areas[an];
+    float score;
+
+    fill_area(filter->image, &filter->frame, a, xoff);
+
+    return compare_area_with_offset(filter, an, a, an, xoff, &score) > 0.0f;
+}
+
+static bool probe_area_withoffset(apex_game_filter_context_t *filter, const area_t *areas, area_name_t an)
+{
+    return probe_area(filter, areas, an, 0) || probe_area(filter, areas, an, filter->layout->match_offsets[filter->display][an]);
+}
+
+/*
+ * a candidate gains a vote when it is the only one matching in the current
+ * frame and the others lose one, it is chosen when it leads by enough votes
+ */
+static int probe_vote(int *hits, int candidates, int winner)
+{
+    for (int c = 0; c < candidates; c++) {
+        if (c == winner) {
+            if (hits[c] < (PROBE_LOCK_HITS * 2))
+                hits[c]++;
+        } else if (hits[c] > 0) {
+            hits[c]--;
+        }
+    }
+
+    return hits[winner] >= PROBE_LOCK_HITS ? winner : -1;
+}
+
+/*
+ * input device and game language are detected by probing only the few areas
+ * that differ between configurations: the in-game buttons tell m&k from pad,
+ * the ESC/pad buttons of looting and inventory are placed differently
+ * depending on the language. until a configuration is locked every frame is
+ * probed, then probing continues once every PROBE_INTERVAL frames to follow
+ * changes in the game settings.
+ */
+static void probe_configuration(apex_game_filter_context_t *filter)
+{
+    struct auto_probe *p = &filter->probe;
+
+    if (!p->input_auto && !p->language_auto)
+        return;
+
+    p->frame++;
+
+    bool probing = (p->input_auto && !p->input_locked) || (p->language_auto && !p->language_locked);
+
+    if (!probing && (p->frame % PROBE_INTERVAL) != 0)
+        return;
+
+    if (p->input_auto) {
+        const area_t *areas = get_areas(filter->layout, filter->display, filter->language);
+
+        bool mk = probe_area(filter, areas, MAP_GAME_BUTTON, 0) ||
+                  probe_area(filter, areas, GRENADE_GAME_BUTTON, 0) ||
+                  probe_area_withoffset(filter, areas, M_MAP_BUTTON);
+        bool pad = probe_area(filter, areas, PAD_TACTICAL_BUTTON, 0) ||
+                   probe_area_withoffset(filter, areas, PAD_MAP_BUTTON);
+
+        if (mk != pad) {
+            int input = probe_vote(p->input_hits, INPUT_DEVICES_NUM, mk ? MOUSE_AND_KEYBOARD : PLAY_STATION_PAD);
+
+            if (input >= 0 && (!p->input_locked || filter->input != (enum input_device)input)) {
+                binfo("detected input device %s", input == MOUSE_AND_KEYBOARD ? "mk" : "ps-pad");
+
+                filter->input = input;
+                p->input_locked = true;
+            }
+        }
+    }
+
+    if (p->language_auto) {
+        area_name_t looting = filter->input == MOUSE_AND_KEYBOARD ? ESC_LOOTING_BUTTON : PAD_LOOTING_BUTTON;
+        area_name_t inventory = filter->input == MOUSE_AND_KEYBOARD ? ESC_INVENTORY_BUTTON : PAD_INVENTORY_BUTTON;
+        int matches = 0;
+        int matched = -1;
+
+        for (enum game_language gl = 0; gl < LANGUAGES; gl++) {
+            const area_t *areas = get_areas(filter->layout, filter->display, gl);
+
+            if (probe_area_withoffset(filter, areas, looting) || probe_area_withoffset(filter, areas, inventory)) {
+                matches++;
+                matched = gl;
+            }
+        }
+
+        if (matches == 1) {
+            int language = probe_vote(p->language_hits, LANGUAGES, matched);
+
+            if (language >= 0 && (!p->language_locked || filter->language != (enum game_language)language)) {
+                binfo("detected game language %s", game_language_str[language]);
+
+                filter->language = language;
+                p->language_locked = true;
+            }
+        }
+    }
+}
+
+static const enum recording_format recording_formats[FRAME_FORMATS_NUM] =
+{
+    [FRAME_RGBA] =  RECORDING_FORMAT_RGBA,
+    [FRAME_BGRA] =  RECORDING_FORMAT_BGRA,
+    [FRAME_NV12] =  RECORDING_FORMAT_NV12,
+    [FRAME_I420] =  RECORDING_FORMAT_I420,
+};
+
+/*
+ * the planes are stored top-down without padding, see frame-recording.h
+ */
+static void record_full_frame(apex_game_filter_context_t *filter, struct recording_record *record)
+{
+    const struct frame_view *frame = &filter->frame;
+    uint32_t row_bytes[3] = { 0 };
+    uint32_t rows[3] = { 0 };
+    size_t size = 0;
+
+    switch (frame->format) {
+    case FRAME_RGBA:
+    case FRAME_BGRA:
+        row_bytes[0] = filter->width * 4;
+        rows[0] = frame->height;
+        break;
+    case FRAME_NV12:
+        row_bytes[0] = filter->width;
+        rows[0] = frame->height;
+        row_bytes[1] = filter->width;
+        rows[1] = frame->height / 2;
+        break;
+    case FRAME_I420:
+        row_bytes[0] = filter->width;
+        rows[0] = frame->height;
+        row_bytes[1] = row_bytes[2] = filter->width / 2;
+        rows[1] = rows[2] = frame->height / 2;
+        break;
+    default:
+        return;
+    }
+
+    for (int plane = 0; plane < 3; plane++)
+        size += (size_t)row_bytes[plane] * rows[plane];
+
+    record->flags = RECORD_FULL_FRAME;
+    record->format = recording_formats[frame->format];
+    memcpy(record->yuv_matrix, frame->yuv_matrix, sizeof(record->yuv_matrix));
+
+    uint8_t *payload = frame_recorder_begin(filter->recorder, record, size);
+
+    if (!payload)
+        return;
+
+    for (int plane = 0; plane < 3; plane++) {
+        for (uint32_t row = 0; row < rows[plane]; row++) {
+            uint32_t src_row = frame->flip ? rows[plane] - 1 - row : row;
+
+            memcpy(payload, frame->planes[plane] + (size_t)src_row * frame->linesize[plane], row_bytes[plane]);
+            payload += row_bytes[plane];
+        }
+    }
+
+    frame_recorder_commit(filter->recorder);
+}
+
+/*
+ * every area of every language is recorded, at its position and at the one
+ * moved by the match offset, so that the configuration probing can be
+ * replayed as well
+ */
+static void record_areas(apex_game_filter_context_t *filter, struct recording_record *record)
+{
+    struct recording_area rects[RECORD_AREAS_MAX];
+    uint32_t count = 0;
+    size_t size = 0;
+
+    for (enum game_language gl = 0; gl < LANGUAGES; gl++) {
+        const area_t *areas = get_areas(filter->layout, filter->display, gl);
+
+        for (area_name_t an = 0; an < AREAS_NUM; an++) {
+            int32_t offsets[2] = { 0, filter->layout->match_offsets[filter->display][an] };
+
+            if (!areas[an].w || !areas[an].h)
+                continue;
+
+            for (int o = 0; o < (offsets[1] ? 2 : 1); o++) {
+                struct recording_area rect = { an, areas[an].x + offsets[o], areas[an].y, areas[an].w, areas[an].h };
+                bool duplicate = false;
+
+                for (uint32_t i = 0; i < count && !duplicate; i++)
+                    duplicate = memcmp(&rects[i], &rect, sizeof(rect)) == 0;
+
+                if (duplicate)
+                    continue;
+
+                rects[count++] = rect;
+                size += sizeof(rect) + (size_t)rect.w * rect.h * sizeof(uint32_t);
+            }
+        }
+    }
+
+    record->areas = count;
+
+    uint8_t *payload = frame_recorder_begin(filter->recorder, record, size);
+
+    if (!payload)
+        return;
+
+    for (uint32_t i = 0; i < count; i++) {
+        const struct recording_area *rect = &rects[i];
+        uint8_t r, g, b;
+
+        memcpy(payload, rect, sizeof(*rect));
+        payload += sizeof(*rect);
+
+        for (uint32_t y = rect->y; y < rect->y + rect->h; y++) {
+            for (uint32_t x = rect->x; x < rect->x + rect->w; x++) {
+                frame_get_rgb(&filter->frame, x, y, &r, &g, &b);
+
+                uint32_t pixel = ((uint32_t)r << 24) | ((uint32_t)g << 16) | ((uint32_t)b << 8);
+
+                memcpy(payload, &pixel, sizeof(pixel));
+                payload += sizeof(pixel);
+            }
+        }
+    }
+
+    frame_recorder_commit(filter->recorder);
+}
+
+static void record_frame(apex_game_filter_context_t *filter)
+{
+    if (filter->record_mode == RECORD_OFF)
+        return;
+
+    if ((filter->record_counter++ % filter->record_interval) != 0)
+        return;
+
+    struct recording_record record =
+    {
+        .frame = filter->record_counter - 1,
+        .timestamp_ns = os_gettime_ns(),
+        .width = filter->width,
+        .height = filter->height,
+        .display = filter->display,
+        .language = filter->language,
+        .input = filter->input,
+        .character = filter->result.character,
+        .spectate_color = filter->result.spectate_color,
+    };
+
+    for (banner_position_t bp = 0; bp < BANNER_POSITION_NUM; bp++)
+        if (filter->result.banners[bp])
+            record.banners |= 1 << bp;
+
+    if (filter->record_mode == RECORD_FRAMES)
+        record_full_frame(filter, &record);
+    else
+        record_areas(filter, &record);
+}
+
+static void log_ssd_benchmark(apex_game_filter_context_t *filter)
+{
+    struct ssd_benchmark total = { 0 };
+
+    for (area_name_t an = 0; an < AREAS_NUM; an++) {
+        total.specialized_ns += filter->ssd_benchmarks[an].specialized_ns;
+        total.generic_ns += filter->ssd_benchmarks[an].generic_ns;
+        total.calls += filter->ssd_benchmarks[an].calls;
+        total.mismatches += filter->ssd_benchmarks[an].mismatches;
+    }
+
+    if (!total.calls)
+        return;
+
+    binfo("ssd kernels: specialized %.1f ns, generic %.1f ns per comparison over %u comparisons, %u mismatches",
+          (double)total.specialized_ns / total.calls, (double)total.generic_ns / total.calls, total.calls, total.mismatches);
+}
+
+/*
+ * the working memory of the matching is carved from the arena of the filter
+ * when the layout, the display or the language change: the pixels of the
+ * frame image (only the areas are ever filled) and the summed-area tables of
+ * the character banner. the frame loop runs without allocations afterwards.
+ */
+static void prepare_work_memory(apex_game_filter_context_t *filter)
+{
+    const area_t *areas = get_areas(filter->layout, filter->display, filter->language);
+
+    if (filter->work_layout == filter->layout && filter->work_areas == areas)
+        return;
+
+    filter->work_layout = filter->layout;
+    filter->work_areas = areas;
+
+    uint32_t w = display_sizes[filter->display][0], h = display_sizes[filter->display][1];
+    size_t image_size = (size_t)w * h * sizeof(l_uint32);
+    size_t sat_size = 0;
+
+    /* probing can switch the language before the character banner is matched */
+    for (enum game_language gl = 0; gl < LANGUAGES; gl++) {
+        const area_t *a = &get_areas(filter->layout, filter->display, gl)[PG_BANNER_IMAGE];
+
+        if (prefilter_sat_size(a->w, a->h) > sat_size)
+            sat_size = prefilter_sat_size(a->w, a->h);
+    }
+
+    work_arena_reset(&filter->work, work_arena_size(image_size) + work_arena_size(sat_size));
+
+    l_uint32 *pixels = work_arena_alloc(&filter->work, image_size);
+
+    filter->pg_prefilter.sat = work_arena_alloc(&filter->work, sat_size);
+    filter->pg_prefilter_size = sat_size;
+
+    if (filter->image)
+        pixSetData(filter->image, NULL);
+
+    pixDestroy(&filter->image);
+
+    filter->image = pixCreateHeader(w, h, 32);
+    pixSetData(filter->image, pixels);
+
+    binfo("working memory: %zu bytes for %ux%u %s", filter->work.capacity, w, h, game_language_str[filter->language]);
+}
+
+static void log_work_memory(apex_game_filter_context_t *filter)
+{
+    binfo("working memory: %zu/%zu bytes, %llu allocations, %llu overflows", filter->work.used, filter->work.capacity,
+          (unsigned long long)filter->work.allocations, (unsigned long long)filter->work.overflows);
+
+    if (filter->work.overflows)
+        bwarn("working memory: the arena was sized too small");
+}
+
+static void match_frame(apex_game_filter_context_t *filter)
+{
+    prepare_work_memory(filter);
+
+    probe_configuration(filter);
+
+    filter->areas = get_areas(filter->layout, filter->display, filter->language);
+
+    select_ssd_kernels(filter);
+
+    /*
+     * in debug mode the allocations still alive after the matching are
+     * counted, on the frames without debug captures. the count is the one of
+     * the whole process: the other threads of OBS add to it too.
+     */
+    bool count_allocations = filter->debug_mode && !debug_should_save(filter);
+    long allocations = count_allocations ? bnum_allocs() : 0;
+
+    uint64_t start = os_gettime_ns();
+
+    if (filter->input == MOUSE_AND_KEYBOARD)
+        match_mk(filter);
+    else if (filter->input == PLAY_STATION_PAD)
+        match_ps4pad(filter);
+
+    if (count_allocations) {
+        long delta = bnum_allocs() - allocations;
+
+        if (delta > 0) {
+            filter->match_allocations += (uint64_t)delta;
+            filter->match_allocation_frames++;
+        }
+    }
+
+    filter->result.timestamp_ns = filter->frame.timestamp_ns;
+    filter->result.latency = filter->latency;
+    filter->result.latency.matched_ns = os_gettime_ns();
+
+    filter->match_time_ns += filter->result.latency.matched_ns - start;
+    filter->match_count++;
+
+    filter->result.detector = filter;
+
+    if (filter->detection_entry)
+        filter->detection_sequence = detection_cache_publish(detection_cache, filter->detection_entry, &filter->result);
+
+    record_frame(filter);
+
+    if (debug_should_print(filter)) {
+        binfo("matching: %.3f ms average over %d frames (%s, %d cores)", filter->match_time_ns / 1000000.0 / filter->match_count,
+              filter->match_count, filter->parallel ? "parallel" : "serial", os_get_logical_cores());
+        binfo("debug captures dropped: %llu", (unsigned long long)debug_writer_dropped(debug_writer));
+
+        log_ssd_benchmark(filter);
+        log_work_memory(filter);
+        log_area_watches(filter);
+
+        if (filter->record_mode != RECORD_OFF)
+            binfo("recorded frames dropped: %llu", (unsigned long long)frame_recorder_dropped(filter->recorder));
+
+        if (filter->prefilter_frames) {
+            double frames = filter->prefilter_frames;
+
+            binfo("character prefilter: %.2f rejects per frame (levels 0/1/2: %.2f/%.2f/%.2f), %.2f full comparisons per frame",
+                  (filter->prefilter_rejects[0] + filter->prefilter_rejects[1] + filter->prefilter_rejects[2]) / frames,
+                  filter->prefilter_rejects[0] / frames, filter->prefilter_rejects[1] / frames, filter->prefilter_rejects[2] / frames,
+                  filter->prefilter_compares / frames);
+        }
+
+        memset(filter->prefilter_rejects, 0, sizeof(filter->prefilter_rejects));
+        filter->prefilter_compares = 0;
+        filter->prefilter_frames = 0;
+
+        if (filter->match_allocation_frames)
+            bwarn("matching: %llu allocations left over %u frames", (unsigned long long)filter->match_allocations,
+                  filter->match_allocation_frames);
+
+        filter->match_allocations = 0;
+        filter->match_allocation_frames = 0;
+
+        struct latency_histogram latency;
+
+        latency_stats_get(&filter->latency_stats, LATENCY_FRAMES, &latency);
+
+        if (latency.count)
+            binfo("latency: %.3f ms average, %.3f ms max, applied after 0/1/2/3/4+ frames: %llu/%llu/%llu/%llu/%llu",
+                  latency.sum_ns[LATENCY_TOTAL] / 1000000.0 / latency.count, latency.max_ns[LATENCY_TOTAL] / 1000000.0,
+                  (unsigned long long)latency.frames[0], (unsigned long long)latency.frames[1], (unsigned long long)latency.frames[2],
+                  (unsigned long long)latency.frames[3], (unsigned long long)latency.frames[4]);
+
+        filter->match_time_ns = 0;
+        filter->match_count = 0;
+    }
+
+    debug_step(filter);
+}
+
+/*
+ * the result is applied to the sources by the next video tick, before the
+ * following frame is rendered
+ */
+static void detection_job(void *param)
+{
+    apex_game_filter_context_t *filter = param;
+
+    match_frame(filter);
+
+    filter->result_ready = true;
+}
+
+static void set_frame_size(apex_game_filter_context_t *filter, uint32_t width, uint32_t height)
+{
+    if (filter->width == width && filter->height == height)
+        return;
+
+    filter->width = width;
+    filter->height = height;
+
+    if (filter->width == 1920 && filter->height == 1080)
+        filter->display = DISPLAY_1080P;
+    else if (filter->width == 2560 && filter->height == 1440)
+        filter->display = DISPLAY_2K;
+    else
+        filter->display = DISPLAY_RESOLUTIONS;
+
+    filter->inventory_tracker.locked = false;
+
+    binfo("new size, %dx%d, display %d", width, height, filter->display);
+}
+
+static void load_1080p_references(struct layout *l)
+{
+    l->banner_references[DISPLAY_1080P][MAP_GAME_BUTTON] = pixReadMemBmp(ref_game_map_bmp, ref_game_map_bmp_size);
+    l->banner_references[DISPLAY_1080P][GRENADE_GAME_BUTTON] = pixReadMemBmp(ref_game_grenade_bmp, ref_game_grenade_bmp_size);
+    l->banner_references[DISPLAY_1080P][ESC_LOOTING_BUTTON] = pixReadMemBmp(ref_looting_bmp, ref_looting_bmp_size);
+    l->banner_references[DISPLAY_1080P][ESC_INVENTORY_BUTTON] = pixReadMemBmp(ref_inventory_bmp, ref_inventory_bmp_size);
+    l->banner_references[DISPLAY_1080P][GRAYBAR_INVENTORY_BUTTON] = pixReadMemBmp(ref_graybar_inventory_bmp, ref_graybar_inventory_bmp_size);
+    l->banner_references[DISPLAY_1080P][M_MAP_BUTTON] = pixReadMemBmp(ref_map_bmp, ref_map_bmp_size);
+    l->banner_references[DISPLAY_1080P][PAD_MAP_BUTTON] = pixReadMemBmp(ref_pad_map_bmp, ref_pad_map_bmp_size);
+    l->banner_references[DISPLAY_1080P][PAD_LOOTING_BUTTON] = pixReadMemBmp(ref_pad_looting_bmp, ref_pad_looting_bmp_size);
+    l->banner_references[DISPLAY_1080P][PAD_INVENTORY_BUTTON] = pixReadMemBmp(ref_pad_inventory_bmp, ref_pad_inventory_bmp_size);
+    l->banner_references[DISPLAY_1080P][PAD_TACTICAL_BUTTON] = pixReadMemBmp(ref_pad_tactical_bmp, ref_pad_tactical_bmp_size);
+    l->banner_references[DISPLAY_1080P][SPECTATE_IMAGE_RED] = pixReadMemBmp(ref_spectate_red_bmp, ref_spectate_red_bmp_size);
+    l->banner_references[DISPLAY_1080P][SPECTATE_IMAGE_GREEN] = pixReadMemBmp(ref_spectate_green_bmp, ref_spectate_green_bmp_size);
+    l->banner_references[DISPLAY_1080P][SPECTATE_IMAGE_ORANGE] = pixReadMemBmp(ref_spectate_orange_bmp, ref_spectate_orange_bmp_size);
+    l->banner_references[DISPLAY_1080P][SPECTATE_IMAGE_BLUE] = pixReadMemBmp(ref_spectate_blue_bmp, ref_spectate_blue_bmp_size);
+
+    l->pg_references[DISPLAY_1080P][BLOODHOUND] = pixReadMemBmp(game_bloodhound_bmp, game_bloodhound_bmp_size);
+    l->pg_references[DISPLAY_1080P][GIBRALTAR] = pixReadMemBmp(game_gibraltar_bmp, game_gibraltar_bmp_size);
+    l->pg_references[DISPLAY_1080P][LIFELINE] = pixReadMemBmp(game_lifeline_bmp, game_lifeline_bmp_size);
+    l->pg_references[DISPLAY_1080P][PATHFINDER] = pixReadMemBmp(game_pathfinder_bmp, game_pathfinder_bmp_size);
+    l->pg_references[DISPLAY_1080P][WRAITH] = pixReadMemBmp(game_wraith_bmp, game_wraith_bmp_size);
+    l->pg_references[DISPLAY_1080P][BANGALORE] = pixReadMemBmp(game_bangalore_bmp, game_bangalore_bmp_size);
+    l->pg_references[DISPLAY_1080P][CAUSTIC] = pixReadMemBmp(game_caustic_bmp, game_caustic_bmp_size);
+    l->pg_references[DISPLAY_1080P][MIRAGE] = pixReadMemBmp(game_mirage_bmp, game_mirage_bmp_size);
+    l->pg_references[DISPLAY_1080P][OCTANE] = pixReadMemBmp(game_octane_bmp, game_octane_bmp_size);
+    l->pg_references[DISPLAY_1080P][WATTSON] = pixReadMemBmp(game_wattson_bmp, game_wattson_bmp_size);
+    l->pg_references[DISPLAY_1080P][CRYPTO] = pixReadMemBmp(game_crypto_bmp, game_crypto_bmp_size);
+    l->pg_references[DISPLAY_1080P][REVENANT] = pixReadMemBmp(game_revenant_bmp, game_revenant_bmp_size);
+    l->pg_references[DISPLAY_1080P][LOBA] = pixReadMemBmp(game_loba_bmp, game_loba_bmp_size);
+    l->pg_references[DISPLAY_1080P][RAMPART] = pixReadMemBmp(game_rampart_bmp, game_rampart_bmp_size);
+    l->pg_references[DISPLAY_1080P][HORIZON] = pixReadMemBmp(game_horizon_bmp, game_horizon_bmp_size);
+    l->pg_references[DISPLAY_1080P][FUSE] = pixReadMemBmp(game_fuse_bmp, game_fuse_bmp_size);
+    l->pg_references[DISPLAY_1080P][VALKYRIE] = pixReadMemBmp(game_valkyrie_bmp, game_valkyrie_bmp_size);
+    l->pg_references[DISPLAY_1080P][SEER] = pixReadMemBmp(game_seer_bmp, game_seer_bmp_size);
+    l->pg_references[DISPLAY_1080P][ASH] = pixReadMemBmp(game_ash_bmp, game_ash_bmp_size);
+    l->pg_references[DISPLAY_1080P][MADMAGGIE] = pixReadMemBmp(game_madmaggie_bmp, game_madmaggie_bmp_size);
+    l->pg_references[DISPLAY_1080P][NEWCASTLE] = pixReadMemBmp(game_newcastle_bmp, game_newcastle_bmp_size);
+    l->pg_references[DISPLAY_1080P][VANTAGE] = pixReadMemBmp(game_vantage_bmp, game_vantage_bmp_size);
+    l->pg_references[DISPLAY_1080P][CATALYST] = pixReadMemBmp(game_catalyst_bmp, game_catalyst_bmp_size);
+    l->pg_references[DISPLAY_1080P][BALLISTIC] = pixReadMemBmp(game_ballistic_bmp, game_ballistic_bmp_size);
+}
+
+static void load_2k_references(struct layout *l)
+{
+    l->banner_references[DISPLAY_2K][MAP_GAME_BUTTON] = pixReadMemBmp(ref_game_map_2k_bmp, ref_game_map_2k_bmp_size);
+    l->banner_references[DISPLAY_2K][GRENADE_GAME_BUTTON] = pixReadMemBmp(ref_game_grenade_2k_bmp, ref_game_grenade_2k_bmp_size);
+    l->banner_references[DISPLAY_2K][ESC_LOOTING_BUTTON] = pixReadMemBmp(ref_looting_2k_bmp, ref_looting_2k_bmp_size);
+    l->banner_references[DISPLAY_2K][ESC_INVENTORY_BUTTON] = pixReadMemBmp(ref_inventory_2k_bmp, ref_inventory_2k_bmp_size);
+    l->banner_references[DISPLAY_2K][GRAYBAR_INVENTORY_BUTTON] = pixReadMemBmp(ref_graybar_inventory_2k_bmp, ref_graybar_inventory_2k_bmp_size);
+    l->banner_references[DISPLAY_2K][M_MAP_BUTTON] = pixReadMemBmp(ref_map_2k_bmp, ref_map_2k_bmp_size);
+    l->banner_references[DISPLAY_2K][PAD_MAP_BUTTON] = pixReadMemBmp(ref_pad_map_2k_bmp, ref_pad_map_2k_bmp_size);
+    l->banner_references[DISPLAY_2K][PAD_LOOTING_BUTTON] = pixReadMemBmp(ref_pad_looting_2k_bmp, ref_pad_looting_2k_bmp_size);
+    l->banner_references[DISPLAY_2K][PAD_INVENTORY_BUTTON] = pixReadMemBmp(ref_pad_inventory_2k_bmp, ref_pad_inventory_2k_bmp_size);
+    l->banner_references[DISPLAY_2K][PAD_TACTICAL_BUTTON] = pixReadMemBmp(ref_pad_tactical_2k_bmp, ref_pad_tactical_2k_bmp_size);
+    l->banner_references[DISPLAY_2K][SPECTATE_IMAGE_RED] = pixReadMemBmp(ref_spectate_red_2k_bmp, ref_spectate_red_2k_bmp_size);
+    l->banner_references[DISPLAY_2K][SPECTATE_IMAGE_GREEN] = pixReadMemBmp(ref_spectate_green_2k_bmp, ref_spectate_green_2k_bmp_size);
+    l->banner_references[DISPLAY_2K][SPECTATE_IMAGE_ORANGE] = pixReadMemBmp(ref_spectate_orange_2k_bmp, ref_spectate_orange_2k_bmp_size);
+    l->banner_references[DISPLAY_2K][SPECTATE_IMAGE_BLUE] = pixReadMemBmp(ref_spectate_blue_2k_bmp, ref_spectate_blue_2k_bmp_size);
+
+    l->pg_references[DISPLAY_2K][BLOODHOUND] = pixReadMemBmp(game_bloodhound_2k_bmp, game_bloodhound_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][GIBRALTAR] = pixReadMemBmp(game_gibraltar_2k_bmp, game_gibraltar_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][LIFELINE] = pixReadMemBmp(game_lifeline_2k_bmp, game_lifeline_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][PATHFINDER] = pixReadMemBmp(game_pathfinder_2k_bmp, game_pathfinder_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][WRAITH] = pixReadMemBmp(game_wraith_2k_bmp, game_wraith_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][BANGALORE] = pixReadMemBmp(game_bangalore_2k_bmp, game_bangalore_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][CAUSTIC] = pixReadMemBmp(game_caustic_2k_bmp, game_caustic_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][MIRAGE] = pixReadMemBmp(game_mirage_2k_bmp, game_mirage_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][OCTANE] = pixReadMemBmp(game_octane_2k_bmp, game_octane_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][WATTSON] = pixReadMemBmp(game_wattson_2k_bmp, game_wattson_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][CRYPTO] = pixReadMemBmp(game_crypto_2k_bmp, game_crypto_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][REVENANT] = pixReadMemBmp(game_revenant_2k_bmp, game_revenant_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][LOBA] = pixReadMemBmp(game_loba_2k_bmp, game_loba_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][RAMPART] = pixReadMemBmp(game_rampart_2k_bmp, game_rampart_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][HORIZON] = pixReadMemBmp(game_horizon_2k_bmp, game_horizon_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][FUSE] = pixReadMemBmp(game_fuse_2k_bmp, game_fuse_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][VALKYRIE] = pixReadMemBmp(game_valkyrie_2k_bmp, game_valkyrie_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][SEER] = pixReadMemBmp(game_seer_2k_bmp, game_seer_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][ASH] = pixReadMemBmp(game_ash_2k_bmp, game_ash_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][MADMAGGIE] = pixReadMemBmp(game_madmaggie_2k_bmp, game_madmaggie_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][NEWCASTLE] = pixReadMemBmp(game_newcastle_2k_bmp, game_newcastle_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][VANTAGE] = pixReadMemBmp(game_vantage_2k_bmp, game_vantage_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][CATALYST] = pixReadMemBmp(game_catalyst_2k_bmp, game_catalyst_2k_bmp_size);
+    l->pg_references[DISPLAY_2K][BALLISTIC] = pixReadMemBmp(game_ballistic_2k_bmp, game_ballistic_2k_bmp_size);
+}
+
+/*
+ * the table of the references lists the banner areas first and then the
+ * characters
+ */
+static PIX *layout_reference(const struct layout *l, enum display_resolution ds, uint32_t index)
+{
+    return index < AREAS_NUM ? l->banner_references[ds][index] : l->pg_references[ds][index - AREAS_NUM];
+}
+
+/*
+ * the matching reads the references from the arena of the display, in the
+ * order of layout_reference()
+ */
+static void build_reference_arena(struct layout *l, enum display_resolution ds)
+{
+    struct reference_source sources[REFERENCES_NUM] = { 0 };
+
+    for (uint32_t i = 0; i < REFERENCES_NUM; i++) {
+        PIX *reference = layout_reference(l, ds, i);
+
+        if (!reference)
+            continue;
+
+        sources[i].pixels = pixGetData(reference);
+        sources[i].wpl = pixGetWpl(reference);
+        sources[i].w = pixGetWidth(reference);
+        sources[i].h = pixGetHeight(reference);
+    }
+
+    reference_arena_build(&l->reference_arenas[ds], sources, REFERENCES_NUM, NCC_MASK_MIN_LUMA);
+}
+
+/*
+ * every area gets a mask, whatever its metric: the metric can be changed
+ * without reloading the layout
+ */
+static void build_glyph_masks(struct layout *l, enum display_resolution ds)
+{
+    for (area_name_t an = 0; an < AREAS_NUM; an++) {
+        PIX *reference = l->banner_references[ds][an];
+
+        if (reference && !glyph_mask_build(&l->glyph_masks[ds][an], pixGetData(reference), pixGetWpl(reference), pixGetWidth(reference),
+                                           pixGetHeight(reference), GLYPH_COLOR_SLACK))
+            bdebug("%s: no glyph mask for the %ux%u reference, compared on its colours", area_name_str[an], display_sizes[ds][0], display_sizes[ds][1]);
+    }
+}
+
+static void build_layout_templates(struct layout *l)
+{
+    for (enum display_resolution ds = 0; ds < DISPLAY_RESOLUTIONS; ds++) {
+        build_reference_arena(l, ds);
+
+        for (area_name_t an = 0; an < AREAS_NUM; an++)
+            build_psnr_bounds(&l->psnr_bounds[ds][an], l->thresholds[ds][an][METRIC_PSNR]);
+
+        build_glyph_masks(l, ds);
+
+        for (character_name_t pg = 0; pg < CHARACTERS_NUM; pg++) {
+            PIX *reference = l->pg_references[ds][pg];
+
+            if (reference)
+                prefilter_reference_init(&l->pg_prefilters[ds][pg], pixGetData(reference), pixGetWpl(reference), pixGetWidth(reference),
+                                         pixGetHeight(reference), NCC_MASK_MIN_LUMA);
+        }
+
+        build_spectate_template(l, ds);
+    }
+}
+
+static void layout_destroy(struct layout *l)
+{
+    if (!l)
+        return;
+
+    for (enum display_resolution ds = 0; ds < DISPLAY_RESOLUTIONS; ds++) {
+        for (area_name_t an = 0; an < AREAS_NUM; an++)
+            pixDestroy(&l->banner_references[ds][an]);
+
+        for (character_name_t pg = 0; pg < CHARACTERS_NUM; pg++) {
+            pixDestroy(&l->pg_references[ds][pg]);
+        }
+
+        reference_arena_free(&l->reference_arenas[ds]);
+        bfree(l->spectate_templates[ds].mask);
+    }
+
+    bfree(l);
+}
+
+static void set_layout_thresholds(struct layout *l, float psnr_threshold, float ncc_threshold)
+{
+    for (enum display_resolution ds = 0; ds < DISPLAY_RESOLUTIONS; ds++) {
+        for (area_name_t an = 0; an < AREAS_NUM; an++) {
+            l->thresholds[ds][an][METRIC_PSNR] = psnr_threshold;
+            l->thresholds[ds][an][METRIC_LUMA_NCC] = ncc_threshold;
+            /* the header has no glyph threshold, packs without the metric get the default */
+            l->thresholds[ds][an][METRIC_GLYPH_MASK] = GLYPH_THRESHOLD_VALUE;
+        }
+    }
+}
+
+static struct layout *layout_create_default(void)
+{
+    struct layout *l = bzalloc(sizeof(struct layout));
+
+    for (enum display_resolution ds = 0; ds < DISPLAY_RESOLUTIONS; ds++) {
+        for (enum game_language gl = 0; gl < LANGUAGES; gl++)
+            l->areas[ds][gl] = get_default_areas(ds, gl);
+
+        l->match_offsets[ds] = default_match_offsets[ds];
+    }
+
+    set_layout_thresholds(l, PSNR_THRESHOLD_VALUE, NCC_THRESHOLD_VALUE);
+
+    load_1080p_references(l);
+    load_2k_references(l);
+
+    build_layout_templates(l);
+
+    return l;
+}
+
+/*
+ * leptonica needs its own copy of the pixels, the pack already stores them in
+ * its 32 bpp word format so the rows are copied without decoding
+ */
+/*
+ * false when the image cannot be allocated, *pix is NULL for a reference the
+ * pack does not have
+ */
+static bool pix_from_pack(const struct layout_pack *pack, const struct layout_pack_reference *ref, PIX **pix)
+{
+    *pix = NULL;
+
+    if (!ref->width || !ref->height)
+        return true;
+
+    *pix = pixCreateNoInit(ref->width, ref->height, 32);
+
+    if (!*pix)
+        return false;
+
+    const uint32_t *src = layout_pack_pixels(pack, ref);
+    l_uint32 *dst = pixGetData(*pix);
+    int wpl = pixGetWpl(*pix);
+
+    for (uint32_t y = 0; y < ref->height; y++)
+        memcpy(dst + y * wpl, src + y * ref->width, ref->width * sizeof(uint32_t));
+
+    return true;
+}
+
+/*
+ * areas are read from the frame without further checks, a pack is refused when
+ * one of them falls outside of the frame (also once moved by its offset) or
+ * when a reference does not have the size of its area
+ */
+static bool check_layout(const struct layout *l, const char *path)
+{
+    for (enum display_resolution ds = 0; ds < DISPLAY_RESOLUTIONS; ds++) {
+        for (enum game_language gl = 0; gl < LANGUAGES; gl++) {
+            for (area_name_t an = 0; an < AREAS_NUM; an++) {
+                const area_t *a = &l->areas[ds][gl][an];
+                int32_t xoff = l->match_offsets[ds][an];
+                int64_t left = (int64_t)a->x + (xoff < 0 ? xoff : 0);
+                int64_t right = (int64_t)a->x + a->w + (xoff > 0 ? xoff : 0);
+
+                if (left < 0 || right > display_sizes[ds][0] || (uint64_t)a->y + a->h > display_sizes[ds][1]) {
+                    bwarn("layout pack %s: area %s outside of the %ux%u frame", path, area_name_str[an], display_sizes[ds][0], display_sizes[ds][1]);
+                    return false;
+                }
+
+                PIX *reference = l->banner_references[ds][an];
+
+                if (reference && ((uint32_t)pixGetWidth(reference) != a->w || (uint32_t)pixGetHeight(reference) != a->h)) {
+                    bwarn("layout pack %s: reference of %s does not match its area", path, area_name_str[an]);
+                    return false;
+                }
+            }
+
+            const area_t *a = &l->areas[ds][gl][PG_BANNER_IMAGE];
+
+            for (character_name_t pg = 0; pg < CHARACTERS_NUM; pg++) {
+                PIX *reference = l->pg_references[ds][pg];
+
+                if (reference && ((uint32_t)pixGetWidth(reference) != a->w || (uint32_t)pixGetHeight(reference) != a->h)) {
+                    bwarn("layout pack %s: reference of %s does not match its area", path, character_name_str[pg]);
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+static struct layout *layout_load(const char *path)
+{
+    struct layout_pack *pack = layout_pack_open(path);
+
+    if (!pack)
+        return NULL;
+
+    const struct layout_pack_header *h = pack->header;
+
+    if (h->resolutions != DISPLAY_RESOLUTIONS || h->languages != LANGUAGES || h->areas_num > AREAS_NUM || h->characters_num != CHARACTERS_NUM) {
+        bwarn("layout pack %s: tables do not match this version of the plugin", path);
+        layout_pack_close(pack);
+        return NULL;
+    }
+
+    struct layout *l = bzalloc(sizeof(struct layout));
+    bool allocated = true;
+
+    /*
+     * the header thresholds apply to the areas without a calibrated value:
+     * the metrics unknown to the pack and the areas it does not place
+     */
+    set_layout_thresholds(l, h->psnr_threshold, h->ncc_threshold);
+
+    for (enum display_resolution ds = 0; ds < DISPLAY_RESOLUTIONS; ds++) {
+        /*
+         * struct layout_pack_area and area_t share the same layout. packs
+         * written before the last areas were added do not place them.
+         */
+        for (enum game_language gl = 0; gl < LANGUAGES; gl++) {
+            memcpy(l->pack_areas[ds][gl], layout_pack_areas(pack, ds, gl), h->areas_num * sizeof(area_t));
+            l->areas[ds][gl] = l->pack_areas[ds][gl];
+        }
+
+        memcpy(l->pack_offsets[ds], layout_pack_offsets(pack, ds), h->areas_num * sizeof(int32_t));
+        l->match_offsets[ds] = l->pack_offsets[ds];
+
+        const float *thresholds = layout_pack_thresholds(pack, ds);
+
+        for (area_name_t an = 0; an < h->areas_num; an++)
+            for (match_metric_t mm = 0; mm < METRICS_NUM && mm < h->metrics_num; mm++)
+                l->thresholds[ds][an][mm] = thresholds[an * h->metrics_num + mm];
+
+        for (area_name_t an = 0; an < h->areas_num; an++)
+            allocated &= pix_from_pack(pack, layout_pack_reference(pack, ds, an), &l->banner_references[ds][an]);
+
+        for (character_name_t pg = 0; pg < CHARACTERS_NUM; pg++)
+            allocated &= pix_from_pack(pack, layout_pack_reference(pack, ds, h->areas_num + pg), &l->pg_references[ds][pg]);
+    }
+
+    /* nothing points into the pack anymore */
+    layout_pack_close(pack);
+
+    if (!allocated) {
+        bwarn("layout pack %s: cannot allocate the references", path);
+        layout_destroy(l);
+        return NULL;
+    }
+
+    if (!check_layout(l, path)) {
+        layout_destroy(l);
+        return NULL;
+    }
+
+    build_layout_templates(l);
+
+    binfo("layout pack %s loaded", path);
+
+    return l;
+}
+
+/*
+ * writes a layout in the pack format, used to export the compiled-in tables as
+ * the starting point of a new pack
+ */
+static bool layout_write(const struct layout *l, const char *path)
+{
+    const uint32_t references_num = DISPLAY_RESOLUTIONS * (AREAS_NUM + CHARACTERS_NUM);
+    struct layout_pack_reference references[DISPLAY_RESOLUTIONS * (AREAS_NUM + CHARACTERS_NUM)];
+    struct layout_pack_header h = { 0 };
+
+    h.magic = LAYOUT_PACK_MAGIC;
+    h.version = LAYOUT_PACK_VERSION;
+    h.resolutions = DISPLAY_RESOLUTIONS;
+    h.languages = LANGUAGES;
+    h.areas_num = AREAS_NUM;
+    h.characters_num = CHARACTERS_NUM;
+    h.psnr_threshold = PSNR_THRESHOLD_VALUE;
+    h.ncc_threshold = NCC_THRESHOLD_VALUE;
+    h.metrics_num = METRICS_NUM;
+    h.areas_offset = sizeof(struct layout_pack_header);
+    h.offsets_offset = h.areas_offset + DISPLAY_RESOLUTIONS * LANGUAGES * AREAS_NUM * sizeof(struct layout_pack_area);
+    h.thresholds_offset = h.offsets_offset + DISPLAY_RESOLUTIONS * AREAS_NUM * sizeof(int32_t);
+    h.references_offset = h.thresholds_offset + sizeof(l->thresholds);
+    h.size = h.references_offset + references_num * sizeof(struct layout_pack_reference);
+
+    for (uint32_t i = 0; i < references_num; i++) {
+        PIX *pix = layout_reference(l, i / (AREAS_NUM + CHARACTERS_NUM), i % (AREAS_NUM + CHARACTERS_NUM));
+
+        references[i].width = pix ? pixGetWidth(pix) : 0;
+        references[i].height = pix ? pixGetHeight(pix) : 0;
+        references[i].pixels_offset = pix ? h.size : 0;
+
+        h.size += references[i].width * references[i].height * sizeof(uint32_t);
+    }
+
+    FILE *f = os_fopen(path, "wb");
+
+    if (!f)
+        return false;
+
+    fwrite(&h, sizeof(h), 1, f);
+
+    for (enum display_resolution ds = 0; ds < DISPLAY_RESOLUTIONS; ds++)
+        for (enum game_language gl = 0; gl < LANGUAGES; gl++)
+            fwrite(l->areas[ds][gl], sizeof(area_t), AREAS_NUM, f);
+
+    for (enum display_resolution ds = 0; ds < DISPLAY_RESOLUTIONS; ds++)
+        fwrite(l->match_offsets[ds], sizeof(int32_t), AREAS_NUM, f);
+
+    fwrite(l->thresholds, sizeof(l->thresholds), 1, f);
+
+    fwrite(references, sizeof(struct layout_pack_reference), references_num, f);
+
+    for (uint32_t i = 0; i < references_num; i++) {
+        PIX *pix = layout_reference(l, i / (AREAS_NUM + CHARACTERS_NUM), i % (AREAS_NUM + CHARACTERS_NUM));
+
+        if (!pix)
+            continue;
+
+        for (uint32_t y = 0; y < references[i].height; y++)
+            fwrite(pixGetData(pix) + y * pixGetWpl(pix), sizeof(uint32_t), references[i].width, f);
+    }
+
+    bool success = !ferror(f);
+
+    fclose(f);
+
+    return success;
+}
+
+/*
+ * the new layout is prepared by the calling thread and swapped in by the video
+ * thread when no detection is running, see apply_pending_layout()
+ */
+static void queue_layout(apex_game_filter_context_t *filter)
+{
+    struct layout *l = *filter->layout_path ? layout_load(filter->layout_path) : layout_create_default();
+
+    if (!l)
+        return;
+
+    pthread_mutex_lock(&filter->layout_mutex);
+    struct layout *replaced = filter->pending_layout;
+    filter->pending_layout = l;
+    pthread_mutex_unlock(&filter->layout_mutex);
+
+    layout_destroy(replaced);
+}
+
+static void apply_pending_layout(apex_game_filter_context_t *filter)
+{
+    pthread_mutex_lock(&filter->layout_mutex);
+    struct layout *l = filter->pending_layout;
+    filter->pending_layout = NULL;
+    pthread_mutex_unlock(&filter->layout_mutex);
+
+    if (!l)
+        return;
+
+    layout_destroy(filter->layout);
+
+    filter->layout = l;
+    filter->inventory_tracker.locked = false;
+    filter->region_layout = NULL;
+}
+
+/*
+ * the detected language and input are kept while the setting stays auto
+ */
+static void apply_pending_settings(apex_game_filter_context_t *filter)
+{
+    struct filter_settings s;
+
+    pthread_mutex_lock(&filter->layout_mutex);
+    bool pending = filter->settings_pending;
+
+    if (pending) {
+        s = filter->pending_settings;
+        filter->pending_settings.record_restart = false;
+        filter->settings_pending = false;
+    }
+
+    pthread_mutex_unlock(&filter->layout_mutex);
+
+    if (!pending)
+        return;
+
+    filter->debug_mode = s.debug_mode;
+    filter->threaded = s.threaded;
+    filter->parallel = s.parallel;
+    filter->region_render = s.region_render;
+    filter->shared_detection = s.shared_detection;
+
+    if (s.language_auto != filter->probe.language_auto) {
+        filter->probe.language_auto = s.language_auto;
+        filter->probe.language_locked = false;
+        memset(filter->probe.language_hits, 0, sizeof(filter->probe.language_hits));
+        filter->language = s.language;
+    } else if (!s.language_auto) {
+        filter->language = s.language;
+    }
+
+    if (s.input_auto != filter->probe.input_auto) {
+        filter->probe.input_auto = s.input_auto;
+        filter->probe.input_locked = false;
+        memset(filter->probe.input_hits, 0, sizeof(filter->probe.input_hits));
+        filter->input = s.input;
+    } else if (!s.input_auto) {
+        filter->input = s.input;
+    }
+
+    memcpy(filter->area_metrics, s.area_metrics, sizeof(filter->area_metrics));
+    filter->debounce = s.debounce;
+    filter->record_mode = s.record_mode;
+    filter->record_interval = s.record_interval;
+
+    if (s.record_restart)
+        filter->record_counter = 0;
+
+    filter->detection_config = s.detection_config;
+}
+
+struct region_bounds
+{
+    int32_t left;
+    int32_t top;
+    int32_t right;
+    int32_t bottom;
+};
+
+static void extend_region(struct region_bounds *b, int32_t x, int32_t y, uint32_t w, uint32_t h)
+{
+    if (x < b->left)
+        b->left = x;
+
+    if (y < b->top)
+        b->top = y;
+
+    if (x + (int32_t)w > b->right)
+        b->right = x + (int32_t)w;
+
+    if (y + (int32_t)h > b->bottom)
+        b->bottom = y + (int32_t)h;
+}
+
+/*
+ * the box of a region is the union of its areas in all the languages and at
+ * their match offsets, so that the probing of the configuration reads rendered
+ * pixels too. the gray lines are searched in the bottom-left region, the
+ * character banner is looked for as far as they can drift.
+ */
+static void update_render_regions(apex_game_filter_context_t *filter)
+{
+    if (filter->region_layout == filter->layout && filter->region_display == filter->display)
+        return;
+
+    filter->region_layout = filter->layout;
+    filter->region_display = filter->display;
+
+    const struct gray_line_searcher_ref *ls = &line_searches[filter->display];
+    struct region_bounds bounds[RENDER_REGIONS_NUM];
+
+    /* displacements the inventory tracker can find, see track_banner_gray_lines() */
+    int32_t dx_min = (int32_t)ls->box_start_x - (int32_t)ls->default_grayline_x_end;
+    int32_t dx_max = (int32_t)(ls->box_start_x + ls->box_witdh) - (int32_t)ls->default_grayline_x_end;
+    int32_t dy_min = (int32_t)(ls->box_start_y + ls->default_grayline_diff) - (int32_t)ls->default_grayline_y;
+    int32_t dy_max = (int32_t)(ls->box_start_y + ls->box_height) - (int32_t)ls->default_grayline_y;
+
+    for (enum render_region rr = 0; rr < RENDER_REGIONS_NUM; rr++)
+        bounds[rr] = (struct region_bounds){ INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN };
+
+    for (enum game_language gl = 0; gl < LANGUAGES; gl++) {
+        const area_t *areas = get_areas(filter->layout, filter->display, gl);
+
+        for (area_name_t an = 0; an < AREAS_NUM; an++) {
+            const area_t *a = &areas[an];
+            int32_t xoff = filter->layout->match_offsets[filter->display][an];
+
+            /* areas the layout does not place */
+            if (!a->w || !a->h)
+                continue;
+
+            extend_region(&bounds[area_regions[an]], a->x, a->y, a->w, a->h);
+            extend_region(&bounds[area_regions[an]], a->x + xoff, a->y, a->w, a->h);
+
+            if (an == PG_BANNER_IMAGE) {
+                extend_region(&bounds[area_regions[an]], a->x + dx_min, a->y + dy_min, a->w, a->h);
+                extend_region(&bounds[area_regions[an]], a->x + dx_max, a->y + dy_max, a->w, a->h);
+            }
+        }
+    }
+
+    extend_region(&bounds[REGION_BOTTOM_LEFT], ls->box_start_x, ls->box_start_y, ls->box_witdh, ls->box_height);
+
+    uint64_t pixels = 0;
+
+    for (enum render_region rr = 0; rr < RENDER_REGIONS_NUM; rr++) {
+        struct region_bounds *b = &bounds[rr];
+        area_t *box = &filter->regions[rr].box;
+
+        if (b->left < 0)
+            b->left = 0;
+
+        if (b->top < 0)
+            b->top = 0;
+
+        if (b->right > (int32_t)filter->width)
+            b->right = filter->width;
+
+        if (b->bottom > (int32_t)filter->height)
+            b->bottom = filter->height;
+
+        if (b->right <= b->left || b->bottom <= b->top) {
+            memset(box, 0, sizeof(*box));
+            continue;
+        }
+
+        box->x = b->left;
+        box->y = b->top;
+        box->w = b->right - b->left;
+        box->h = b->bottom - b->top;
+
+        pixels += (uint64_t)box->w * box->h;
+
+        binfo("render region %s: %ux%u at %u,%u", render_region_str[rr], box->w, box->h, box->x, box->y);
+    }
+
+    binfo("render regions: %.1f%% of the %ux%u frame", 100.0 * pixels / ((uint64_t)filter->width * filter->height), filter->width,
+          filter->height);
+}
+
+/*
+ * renders the box of the parent in the texture render with the projection
+ * moved on it, then maps the staging copy of the texture
+ */
+static bool render_box(obs_source_t *parent, gs_texrender_t *texrender, gs_stagesurf_t **stagesurface, const area_t *box, uint8_t **data,
+                       uint32_t *linesize)
+{
+    gs_texrender_reset(texrender);
+
+    if (!gs_texrender_begin(texrender, box->w, box->h))
+        return false;
+
+    struct vec4 background;
+
+    vec4_zero(&background);
+
+    gs_clear(GS_CLEAR_COLOR, &background, 0.0f, 0);
+    gs_ortho((float)box->x, (float)(box->x + box->w), (float)box->y, (float)(box->y + box->h), -100.0f, 100.0f);
+
+    gs_blend_state_push();
+    gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+    obs_source_video_render(parent);
+
+    gs_blend_state_pop();
+    gs_texrender_end(texrender);
+
+    if (*stagesurface && (gs_stagesurface_get_width(*stagesurface) != box->w || gs_stagesurface_get_height(*stagesurface) != box->h)) {
+        gs_stagesurface_destroy(*stagesurface);
+        *stagesurface = NULL;
+    }
+
+    if (!*stagesurface)
+        *stagesurface = gs_stagesurface_create(box->w, box->h, GS_RGBA);
+
+    gs_stage_texture(*stagesurface, gs_texrender_get_texture(texrender));
+
+    if (!gs_stagesurface_map(*stagesurface, data, linesize)) {
+        *data = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+static bool render_regions(apex_game_filter_context_t *filter, obs_source_t *parent)
+{
+    update_render_regions(filter);
+
+    for (enum render_region rr = 0; rr < RENDER_REGIONS_NUM; rr++) {
+        struct frame_region *region = &filter->regions[rr];
+
+        if (!region->box.w)
+            continue;
+
+        if (!filter->region_texrenders[rr])
+            filter->region_texrenders[rr] = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+
+        if (!render_box(parent, filter->region_texrenders[rr], &filter->region_stagesurfaces[rr], &region->box, &region->data, &region->linesize))
+            return false;
+    }
+
+    filter->frame.format = FRAME_REGIONS;
+    filter->frame.regions = filter->regions;
+
+    return true;
+}
+
+static bool render_full_frame(apex_game_filter_context_t *filter, obs_source_t *parent)
+{
+    area_t box = { 0, 0, filter->width, filter->height };
+
+    if (!render_box(parent, filter->texrender, &filter->stagesurface, &box, &filter->video_data, &filter->video_linesize))
+        return false;
+
+    filter->frame.format = FRAME_RGBA;
+    filter->frame.planes[0] = filter->video_data;
+    filter->frame.linesize[0] = filter->video_linesize;
+
+    return true;
+}
+
+/*
+ * the detection job of the previous frame reads the mapped staging surfaces,
+ * it must be completed before they are unmapped
+ */
+static void unmap_frame(apex_game_filter_context_t *filter)
+{
+    if (filter->video_data) {
+        gs_stagesurface_unmap(filter->stagesurface);
+        filter->video_data = NULL;
+    }
+
+    for (enum render_region rr = 0; rr < RENDER_REGIONS_NUM; rr++) {
+        if (!filter->regions[rr].data)
+            continue;
+
+        gs_stagesurface_unmap(filter->region_stagesurfaces[rr]);
+        filter->regions[rr].data = NULL;
+    }
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = data;
+
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+
+    return hash;
+}
+
+/*
+ * fnv-1a of the settings that decide the result of the detection, the
+ * debounce is applied by every filter to the shared result. with the
+ * automatic language or input the filter that detects the frame probes them.
+ */
+static uint64_t detection_config(const apex_game_filter_context_t *filter, const struct filter_settings *s)
+{
+    int32_t values[] =
+    {
+        filter->async,
+        s->language_auto ? -1 : (int32_t)s->language,
+        s->input_auto ? -1 : (int32_t)s->input,
+    };
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    hash = hash_bytes(hash, values, sizeof(values));
+    hash = hash_bytes(hash, s->area_metrics, sizeof(s->area_metrics));
+
+    if (filter->layout_path)
+        hash = hash_bytes(hash, filter->layout_path, strlen(filter->layout_path));
+
+    return hash;
+}
+
+static void leave_detection_cache(apex_game_filter_context_t *filter)
+{
+    if (!filter->detection_entry)
+        return;
 
-        activate_inventory =  gray_line_found;
-    }
+    detection_cache_release(detection_cache, filter->detection_entry, filter);
+    filter->detection_entry = NULL;
+    filter->detection_sequence = 0;
+}
 
-    set_source_status(filter->target_sources[BANNER_INVENTORY], activate_inventory);
+/*
+ * returns false when another filter on the same parent detects the frame.
+ * the filters that save debug captures or record have to see the frames
+ * themselves.
+ */
+static bool claim_detection(apex_game_filter_context_t *filter, const obs_source_t *parent, uint64_t frame_ns)
+{
+    bool share = filter->shared_detection && detection_cache && !filter->debug_mode && filter->record_mode == RECORD_OFF;
 
-    /*
-     * in game matching is a little bit more difficult since when pg info button was removed
-     * first we try to identify the pg in the bottom left part of the screen, this should cover the
-     * majority of occurreciens.
-     * in some situations the pg is not recognizable (ie. when player receives damage the pg image
-     * pulses with a red color making recognition unreliable), therefore we use the L1 button
-     * of the tactical ability
-     */
-    bool enable_banner_game = false;
+    if (filter->detection_entry && (!share || parent != filter->detection_parent || filter->detection_config != filter->detection_entry_config))
+        leave_detection_cache(filter);
 
-    character_name_t pg = get_pg_showed(filter);
+    if (!share)
+        return true;
 
-    if (pg != CHARACTERS_NUM) {
-        enable_banner_game = true;
-    } else {
-        enable_banner_game = get_area_status(filter, PAD_TACTICAL_BUTTON);
+    if (!filter->detection_entry) {
+        filter->detection_parent = parent;
+        filter->detection_entry_config = filter->detection_config;
+        filter->detection_entry = detection_cache_acquire(detection_cache, parent, filter->detection_config, sizeof(struct detection_result));
     }
 
-    set_source_status(filter->target_sources[BANNER_GAME], enable_banner_game);
+    return detection_cache_claim(detection_cache, filter->detection_entry, filter, frame_ns);
+}
 
-    /*
-     * spectate matching is done by checking a portion of the bottom center frame
-     * with the name of the spectating person.
-     * there are 4 different colors depending on who is spectating: red: enemy,
-     * orange/blue/green: team mate.
-     */
-    bool spectate_red = get_area_status(filter, SPECTATE_IMAGE_RED);
-    bool spectate_green = get_area_status(filter, SPECTATE_IMAGE_GREEN);
-    bool spectate_orange = get_area_status(filter, SPECTATE_IMAGE_ORANGE);
-    bool spectate_blue = get_area_status(filter, SPECTATE_IMAGE_BLUE);
-    bool activate_specatate = spectate_red || spectate_green || spectate_orange || spectate_blue;
+/*
+ * applies the result published by the filter that detected the frame, if it
+ * was not applied yet. it replaces a result of the filter still waiting for
+ * the tick, the debounce sees every frame once.
+ */
+static void follow_detection(apex_game_filter_context_t *filter)
+{
+    if (!filter->detection_entry || !detection_cache_fetch(detection_cache, filter->detection_entry, &filter->result, &filter->detection_sequence))
+        return;
 
-    set_source_status(filter->target_sources[BANNER_SPECTATE], activate_specatate);
+    filter->result_ready = false;
+
+    apply_result(filter);
 }
 
 static void apex_game_filter_offscreen_render(void *data, uint32_t cx, uint32_t cy)
@@ -942,6 +3716,7 @@ static void apex_game_filter_offscreen_render(void *data, uint32_t cx, uint32_t
     UNUSED_PARAMETER(cy);
 
     apex_game_filter_context_t *filter = data;
+    uint64_t capture_ns = os_gettime_ns();
 
     if (filter->closing)
         return;
@@ -959,243 +3734,478 @@ static void apex_game_filter_offscreen_render(void *data, uint32_t cx, uint32_t
     if (filter->display == DISPLAY_RESOLUTIONS)
         return;
 
-    gs_texrender_reset(filter->texrender);
+    worker_group_wait(detection_pool, &filter->detection);
+
+    unmap_frame(filter);
 
-    if (!gs_texrender_begin(filter->texrender, filter->width, filter->height))
+    if (!claim_detection(filter, parent, obs_get_video_frame_time())) {
+        follow_detection(filter);
         return;
+    }
+
+    filter->latency.capture_ns = capture_ns;
+    filter->latency.capture_frame_ns = obs_get_video_frame_time();
 
     if (debug_should_print(filter))
         binfo("frame: %d", filter->debug_counter);
 
-    struct vec4 background;
+    /* full frames are recorded as they are */
+    if (filter->region_render && filter->layout && filter->record_mode != RECORD_FRAMES) {
+        if (!render_regions(filter, parent))
+            return;
+    } else {
+        if (!render_full_frame(filter, parent))
+            return;
+    }
 
-    vec4_zero(&background);
+    filter->latency.readback_ns = os_gettime_ns();
 
-    gs_clear(GS_CLEAR_COLOR, &background, 0.0f, 0);
-    gs_ortho(0.0f, (float)filter->width, 0.0f, (float)filter->height, -100.0f, 100.0f);
+    filter->frame.height = filter->height;
+    filter->frame.flip = false;
+    filter->frame.timestamp_ns = obs_get_video_frame_time();
 
-    gs_blend_state_push();
-    gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+    if (filter->threaded && detection_pool) {
+        worker_pool_submit(detection_pool, &filter->detection, detection_job, filter);
+    } else {
+        match_frame(filter);
+        apply_result(filter);
+    }
+}
 
-    obs_source_video_render(parent);
+/*
+ * called with the target mutex held
+ */
+static void resolve_target_source(apex_game_filter_context_t *filter, banner_position_t bp)
+{
+    if (filter->target_sources[bp]) {
+        obs_weak_source_release(filter->target_sources[bp]);
+        filter->target_sources[bp] = NULL;
+    }
 
-    gs_blend_state_pop();
-    gs_texrender_end(filter->texrender);
+    if (!filter->target_names[bp] || !*filter->target_names[bp])
+        return;
 
-    uint32_t surface_width = gs_stagesurface_get_width(filter->stagesurface);
-    uint32_t surface_height = gs_stagesurface_get_height(filter->stagesurface);
+    obs_source_t *source = obs_get_source_by_name(filter->target_names[bp]);
 
-    if (surface_width != filter->width || surface_height != filter->height) {
-        gs_stagesurface_destroy(filter->stagesurface);
-        filter->stagesurface = NULL;
+    if (source) {
+        filter->target_sources[bp] = obs_source_get_weak_source(source);
+        obs_source_release(source);
     }
+}
 
-    if (filter->video_data) {
-        gs_stagesurface_unmap(filter->stagesurface);
-        filter->video_data = NULL;
+/*
+ * returns true when the source was looked up again: its name changed or it
+ * was not found the last time (ie. a scene collection loads the filter before
+ * the source)
+ */
+static bool update_source(apex_game_filter_context_t *filter, obs_data_t *settings, banner_position_t bp)
+{
+    const char *name = obs_data_get_string(settings, target_source_keys[bp]);
+
+    pthread_mutex_lock(&filter->target_mutex);
+
+    bool same_name = filter->target_names[bp] && strcmp(name, filter->target_names[bp]) == 0;
+
+    if (same_name && (filter->target_sources[bp] || !*name)) {
+        pthread_mutex_unlock(&filter->target_mutex);
+        return false;
     }
 
-    if (!filter->stagesurface)
-        filter->stagesurface = gs_stagesurface_create(filter->width, filter->height, GS_RGBA);
+    if (!same_name) {
+        bfree(filter->target_names[bp]);
+        filter->target_names[bp] = bstrdup(name);
+    }
+
+    resolve_target_source(filter, bp);
+
+    pthread_mutex_unlock(&filter->target_mutex);
+
+    return true;
+}
+
+/*
+ * a source created or renamed may take the name of a target, a target removed
+ * or renamed no longer has it. the signals come from any thread and only mark
+ * the targets, they are looked up again in the next tick (in the next frame
+ * for the async filter).
+ */
+static void target_source_signal(void *data, calldata_t *cd)
+{
+    UNUSED_PARAMETER(cd);
 
-    gs_stage_texture(filter->stagesurface, gs_texrender_get_texture(filter->texrender));
+    apex_game_filter_context_t *filter = data;
+
+    os_atomic_set_bool(&filter->targets_stale, true);
+}
+
+static const char *target_source_signals[] =
+{
+    "source_create",
+    "source_remove",
+    "source_rename",
+};
 
-    if (!gs_stagesurface_map(filter->stagesurface, &filter->video_data, &filter->video_linesize))
+static void refresh_target_sources(apex_game_filter_context_t *filter)
+{
+    if (!os_atomic_set_bool(&filter->targets_stale, false))
         return;
 
-    if (filter->display == DISPLAY_1080P) {
-        if (filter->language == LANGUAGE_EN)
-            filter->areas = areas_1080p_en;
-        else if (filter->language == LANGUAGE_IT)
-            filter->areas = areas_1080p_it;
-        else if (filter->language == LANGUAGE_ZH)
-            filter->areas = areas_1080p_zh;
-    } else if (filter->display == DISPLAY_2K) {
-        if (filter->language == LANGUAGE_EN)
-            filter->areas = areas_2k_en;
-        else if (filter->language == LANGUAGE_IT)
-            filter->areas = areas_2k_it;
-        else if (filter->language == LANGUAGE_ZH)
-            filter->areas = areas_2k_zh;
+    pthread_mutex_lock(&filter->target_mutex);
+
+    for (banner_position_t bp = 0; bp < BANNER_POSITION_NUM; bp++)
+        resolve_target_source(filter, bp);
+
+    pthread_mutex_unlock(&filter->target_mutex);
+}
+
+/*
+ * async sources (ie. capture cards) already have their frames in system memory,
+ * the areas of interest are read straight from the frame planes without
+ * rendering and downloading the parent from the GPU
+ */
+static struct obs_source_frame *apex_game_filter_video(void *data, struct obs_source_frame *frame)
+{
+    apex_game_filter_context_t *filter = data;
+    uint64_t capture_ns = os_gettime_ns();
+
+    if (filter->closing)
+        return frame;
+
+    /* the async filter has no tick */
+    refresh_target_sources(filter);
+
+    if (!obs_source_enabled(filter->source))
+        return frame;
+
+    switch (frame->format) {
+    case VIDEO_FORMAT_NV12:
+        filter->frame.format = FRAME_NV12;
+        break;
+    case VIDEO_FORMAT_I420:
+        filter->frame.format = FRAME_I420;
+        break;
+    case VIDEO_FORMAT_RGBA:
+        filter->frame.format = FRAME_RGBA;
+        break;
+    case VIDEO_FORMAT_BGRA:
+    case VIDEO_FORMAT_BGRX:
+        filter->frame.format = FRAME_BGRA;
+        break;
+    default:
+        return frame;
     }
 
-    if (filter->input == MOUSE_AND_KEYBOARD)
-        match_mk(filter);
-    else if (filter->input == PLAY_STATION_PAD)
-        match_ps4pad(filter);
+    set_frame_size(filter, frame->width, frame->height);
 
-    debug_step(filter);
+    if (filter->display == DISPLAY_RESOLUTIONS)
+        return frame;
+
+    apply_pending_layout(filter);
+    apply_pending_settings(filter);
+
+    for (int plane = 0; plane < 3; plane++) {
+        filter->frame.planes[plane] = frame->data[plane];
+        filter->frame.linesize[plane] = frame->linesize[plane];
+    }
+
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 3; col++)
+            filter->frame.yuv_matrix[row][col] = (int32_t)lrintf(frame->color_matrix[row * 4 + col] * 65536.0f);
+
+        filter->frame.yuv_matrix[row][3] = (int32_t)lrintf(frame->color_matrix[row * 4 + 3] * 255.0f * 65536.0f);
+    }
+
+    filter->frame.height = frame->height;
+    filter->frame.flip = frame->flip;
+    filter->frame.timestamp_ns = frame->timestamp;
+
+    /* the frame is already in system memory */
+    filter->latency.capture_ns = capture_ns;
+    filter->latency.readback_ns = capture_ns;
+    filter->latency.capture_frame_ns = obs_get_video_frame_time();
+
+    if (!claim_detection(filter, obs_filter_get_parent(filter->source), frame->timestamp)) {
+        follow_detection(filter);
+        return frame;
+    }
+
+    match_frame(filter);
+    apply_result(filter);
+
+    return frame;
 }
 
-static void update_source(obs_data_t *settings, const char *set_name, obs_weak_source_t **s)
+/*
+ * every change of the recording settings starts a new file
+ */
+#define RECORDING_NAME_ATTEMPTS     16
+
+/*
+ * the name of the filter tells apart the recordings of the filters started in
+ * the same second, a counter the ones left in the directory with the same name.
+ * returns the mode of the recording started, RECORD_OFF when none was.
+ */
+static enum record_mode update_recording(apex_game_filter_context_t *filter, enum record_mode mode, const char *dir)
 {
-    const char *set_source_name = obs_data_get_string(settings, set_name);
+    char stamp[32];
+    char source[64];
+    char path[DEBUG_SAVE_PATH_NAME_LEN];
 
-    if (!strlen(set_source_name)) {
-        if (*s) {
-            obs_weak_source_release(*s);
-            *s = NULL;
-        }
-    } else {
-        obs_source_t *cur_source = obs_weak_source_get_source(*s);
+    /* records begun by a detection still running are dropped */
+    frame_recorder_stop(filter->recorder);
 
-        if (cur_source)
-            obs_source_release(cur_source);
+    if (mode == RECORD_OFF || !*dir)
+        return RECORD_OFF;
 
-        if (!cur_source || strcmp(set_source_name, obs_source_get_name(cur_source)) != 0) {
-            if (*s) {
-                obs_weak_source_release(*s);
-                *s = NULL;
-            }
+    time_t now = time(NULL);
+    const char *source_name = obs_source_get_name(filter->source);
 
-            cur_source = obs_get_source_by_name(set_source_name);
-            if (cur_source) {
-                *s = obs_source_get_weak_source(cur_source);
-                obs_source_release(cur_source);
-            }
-        }
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d_%H-%M-%S", localtime(&now));
+    snprintf(source, sizeof(source), "%s", source_name ? source_name : "");
+
+    for (char *c = source; *c; c++) {
+        if (!((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') || *c == '-' || *c == '_'))
+            *c = '_';
+    }
+
+    os_mkdirs(dir);
+
+    bool started = false;
+
+    for (int attempt = 0; attempt < RECORDING_NAME_ATTEMPTS && !started; attempt++) {
+        if (attempt)
+            snprintf(path, sizeof(path), "%s/apex-game-%s-%s-%d." RECORDING_EXTENSION, dir, source, stamp, attempt);
+        else
+            snprintf(path, sizeof(path), "%s/apex-game-%s-%s." RECORDING_EXTENSION, dir, source, stamp);
+
+        started = frame_recorder_start(filter->recorder, path, filter->record_compress);
+
+        /* only a name already taken is worth another attempt */
+        if (!started && !os_file_exists(path))
+            break;
+    }
+
+    if (!started) {
+        bwarn("unable to record to %s", path);
+        return RECORD_OFF;
     }
+
+    binfo("recording %s to %s", record_mode_str[mode], path);
+
+    return mode;
 }
 
 static void apex_game_filter_update(void *data, obs_data_t *settings)
 {
     apex_game_filter_context_t *filter = data;
+    uint64_t start = os_gettime_ns();
+    uint32_t resolved = 0;
+
+    /* also the .load callback: a scene collection loads each filter twice with the same settings */
+    for (banner_position_t bp = 0; bp < BANNER_POSITION_NUM; bp++)
+        resolved += update_source(filter, settings, bp);
+
+    const char *layout_path = obs_data_get_string(settings, "layout_pack");
 
-    binfo("update");
+    if (!filter->layout_path || strcmp(layout_path, filter->layout_path) != 0) {
+        bfree(filter->layout_path);
+        filter->layout_path = bstrdup(layout_path);
 
-    update_source(settings, "game_source", &filter->target_sources[BANNER_GAME]);
-    update_source(settings, "looting_source", &filter->target_sources[BANNER_LOOTING]);
-    update_source(settings, "inventory_source", &filter->target_sources[BANNER_INVENTORY]);
-    update_source(settings, "map_source", &filter->target_sources[BANNER_MAP]);
-    update_source(settings, "spectate_source", &filter->target_sources[BANNER_SPECTATE]);
+        queue_layout(filter);
+    }
+
+    pthread_mutex_lock(&filter->layout_mutex);
+    struct filter_settings s = filter->pending_settings;
+    pthread_mutex_unlock(&filter->layout_mutex);
+
+    bool debug_mode = obs_data_get_bool(settings, "debug_mode");
+    const char *debug_path = obs_data_get_string(settings, "debug_path");
+
+    if (debug_mode != s.debug_mode || strcmp(debug_path, filter->debug_path) != 0) {
+        pthread_mutex_lock(&filter->debug_mutex);
+        snprintf(filter->debug_path, sizeof(filter->debug_path), "%s", debug_path);
+        pthread_mutex_unlock(&filter->debug_mutex);
 
-    filter->debug_mode = obs_data_get_bool(settings, "debug_mode");
+        if (debug_mode && *debug_path)
+            os_mkdirs(debug_path);
+    }
+
+    s.debug_mode = debug_mode;
+    s.threaded = obs_data_get_bool(settings, "threaded_detection");
+    s.parallel = obs_data_get_bool(settings, "parallel_detectors");
+    s.region_render = obs_data_get_bool(settings, "region_render");
+    s.shared_detection = obs_data_get_bool(settings, "shared_detection");
 
     const char *game_lang = obs_data_get_string(settings, "game_lang");
 
+    s.language_auto = strcmp(game_lang, "auto") == 0;
+
     if (strcmp(game_lang, "it") == 0)
-        filter->language = LANGUAGE_IT;
-    else if (strcmp(game_lang, "en") == 0)
-        filter->language = LANGUAGE_EN;
+        s.language = LANGUAGE_IT;
     else if (strcmp(game_lang, "zh") == 0)
-        filter->language = LANGUAGE_ZH;
+        s.language = LANGUAGE_ZH;
     else
-        filter->language = LANGUAGE_EN;
+        s.language = LANGUAGE_EN;
 
     const char *game_input = obs_data_get_string(settings, "game_input");
 
-    if (strcmp(game_input, "mk") == 0)
-        filter->input = MOUSE_AND_KEYBOARD;
-    else if (strcmp(game_input, "ps-pad") == 0)
-        filter->input = PLAY_STATION_PAD;
-    else
-        filter->input = MOUSE_AND_KEYBOARD;
+    s.input_auto = strcmp(game_input, "auto") == 0;
+    s.input = strcmp(game_input, "ps-pad") == 0 ? PLAY_STATION_PAD : MOUSE_AND_KEYBOARD;
+
+    const char *record_mode = obs_data_get_string(settings, "record_mode");
+    const char *record_path = obs_data_get_string(settings, "record_path");
+    bool record_compress = obs_data_get_bool(settings, "record_compress");
+    enum record_mode mode = RECORD_OFF;
+    long long record_interval = obs_data_get_int(settings, "record_interval");
+    bool record_restart = false;
+
+    for (enum record_mode rm = 0; rm < RECORD_MODES_NUM; rm++)
+        if (strcmp(record_mode, record_mode_str[rm]) == 0)
+            mode = rm;
+
+    s.record_interval = record_interval > 0 ? (uint32_t)record_interval : 1;
+
+    if (mode != s.record_mode || record_compress != filter->record_compress || !filter->record_path ||
+        strcmp(record_path, filter->record_path) != 0) {
+        bfree(filter->record_path);
+        filter->record_path = bstrdup(record_path);
+        filter->record_compress = record_compress;
+
+        s.record_mode = update_recording(filter, mode, record_path);
+        record_restart = s.record_mode != RECORD_OFF;
+    }
+
+    long long enter_frames = obs_data_get_int(settings, "debounce_enter_frames");
+    long long exit_frames = obs_data_get_int(settings, "debounce_exit_frames");
+
+    s.debounce.enter_frames = enter_frames > 0 ? (uint32_t)enter_frames : 1;
+    s.debounce.exit_frames = exit_frames > 0 ? (uint32_t)exit_frames : 1;
+    s.debounce.hysteresis = (float)obs_data_get_double(settings, "debounce_hysteresis");
+
+    const char *export_name = obs_data_get_string(settings, "export_name");
+
+    /* names that differ only in the characters replaced make the same segment */
+    if (!filter->export_name || strcmp(export_name, filter->export_name) != 0) {
+        pthread_mutex_lock(&filter->state_mutex);
+        struct hud_export *previous = filter->export;
+        filter->export = NULL;
+        pthread_mutex_unlock(&filter->state_mutex);
+
+        hud_export_destroy(previous);
+
+        struct hud_export *export = *export_name ? hud_export_create(export_name) : NULL;
+
+        pthread_mutex_lock(&filter->state_mutex);
+        filter->export = export;
+        pthread_mutex_unlock(&filter->state_mutex);
+
+        bfree(filter->export_name);
+        filter->export_name = bstrdup(export_name);
+    }
+
+    for (area_name_t an = 0; an < AREAS_NUM; an++) {
+        char key[64];
+        match_metric_t metric = default_area_metrics[an];
+
+        snprintf(key, sizeof(key), "metric_%s", area_name_str[an]);
+
+        const char *name = obs_data_get_string(settings, key);
+
+        for (match_metric_t mm = 0; mm < METRICS_NUM; mm++)
+            if (strcmp(name, match_metric_str[mm]) == 0)
+                metric = mm;
+
+        s.area_metrics[an] = metric;
+    }
+
+    s.detection_config = detection_config(filter, &s);
+
+    /* a restart not applied yet is kept */
+    pthread_mutex_lock(&filter->layout_mutex);
+    s.record_restart = record_restart || filter->pending_settings.record_restart;
+    filter->pending_settings = s;
+    filter->settings_pending = true;
+    pthread_mutex_unlock(&filter->layout_mutex);
+
+    uint64_t elapsed = os_gettime_ns() - start;
+    long count = os_atomic_inc_long(&updates_count);
+
+    add_update_time(elapsed);
+
+    if (debug_mode)
+        binfo("update of '%s': %.3f ms, %u sources looked up (%ld updates, %.3f ms in all the filters)", obs_source_get_name(filter->source),
+              elapsed / 1e6, resolved, count, os_atomic_load_long(&updates_us) / 1e3);
 }
 
 static void apex_game_filter_defaults(obs_data_t *settings)
 {
-    UNUSED_PARAMETER(settings);
-}
-
-static void load_1080p_references(apex_game_filter_context_t *filter)
-{
-    filter->banner_references[DISPLAY_1080P][MAP_GAME_BUTTON] = pixReadMemBmp(ref_game_map_bmp, ref_game_map_bmp_size);
-    filter->banner_references[DISPLAY_1080P][GRENADE_GAME_BUTTON] = pixReadMemBmp(ref_game_grenade_bmp, ref_game_grenade_bmp_size);
-    filter->banner_references[DISPLAY_1080P][ESC_LOOTING_BUTTON] = pixReadMemBmp(ref_looting_bmp, ref_looting_bmp_size);
-    filter->banner_references[DISPLAY_1080P][ESC_INVENTORY_BUTTON] = pixReadMemBmp(ref_inventory_bmp, ref_inventory_bmp_size);
-    filter->banner_references[DISPLAY_1080P][GRAYBAR_INVENTORY_BUTTON] = pixReadMemBmp(ref_graybar_inventory_bmp, ref_graybar_inventory_bmp_size);
-    filter->banner_references[DISPLAY_1080P][M_MAP_BUTTON] = pixReadMemBmp(ref_map_bmp, ref_map_bmp_size);
-    filter->banner_references[DISPLAY_1080P][PAD_MAP_BUTTON] = pixReadMemBmp(ref_pad_map_bmp, ref_pad_map_bmp_size);
-    filter->banner_references[DISPLAY_1080P][PAD_LOOTING_BUTTON] = pixReadMemBmp(ref_pad_looting_bmp, ref_pad_looting_bmp_size);
-    filter->banner_references[DISPLAY_1080P][PAD_INVENTORY_BUTTON] = pixReadMemBmp(ref_pad_inventory_bmp, ref_pad_inventory_bmp_size);
-    filter->banner_references[DISPLAY_1080P][PAD_TACTICAL_BUTTON] = pixReadMemBmp(ref_pad_tactical_bmp, ref_pad_tactical_bmp_size);
-    filter->banner_references[DISPLAY_1080P][SPECTATE_IMAGE_RED] = pixReadMemBmp(ref_spectate_red_bmp, ref_spectate_red_bmp_size);
-    filter->banner_references[DISPLAY_1080P][SPECTATE_IMAGE_GREEN] = pixReadMemBmp(ref_spectate_green_bmp, ref_spectate_green_bmp_size);
-    filter->banner_references[DISPLAY_1080P][SPECTATE_IMAGE_ORANGE] = pixReadMemBmp(ref_spectate_orange_bmp, ref_spectate_orange_bmp_size);
-    filter->banner_references[DISPLAY_1080P][SPECTATE_IMAGE_BLUE] = pixReadMemBmp(ref_spectate_blue_bmp, ref_spectate_blue_bmp_size);
-
-    filter->pg_references[DISPLAY_1080P][BLOODHOUND] = pixReadMemBmp(game_bloodhound_bmp, game_bloodhound_bmp_size);
-    filter->pg_references[DISPLAY_1080P][GIBRALTAR] = pixReadMemBmp(game_gibraltar_bmp, game_gibraltar_bmp_size);
-    filter->pg_references[DISPLAY_1080P][LIFELINE] = pixReadMemBmp(game_lifeline_bmp, game_lifeline_bmp_size);
-    filter->pg_references[DISPLAY_1080P][PATHFINDER] = pixReadMemBmp(game_pathfinder_bmp, game_pathfinder_bmp_size);
-    filter->pg_references[DISPLAY_1080P][WRAITH] = pixReadMemBmp(game_wraith_bmp, game_wraith_bmp_size);
-    filter->pg_references[DISPLAY_1080P][BANGALORE] = pixReadMemBmp(game_bangalore_bmp, game_bangalore_bmp_size);
-    filter->pg_references[DISPLAY_1080P][CAUSTIC] = pixReadMemBmp(game_caustic_bmp, game_caustic_bmp_size);
-    filter->pg_references[DISPLAY_1080P][MIRAGE] = pixReadMemBmp(game_mirage_bmp, game_mirage_bmp_size);
-    filter->pg_references[DISPLAY_1080P][OCTANE] = pixReadMemBmp(game_octane_bmp, game_octane_bmp_size);
-    filter->pg_references[DISPLAY_1080P][WATTSON] = pixReadMemBmp(game_wattson_bmp, game_wattson_bmp_size);
-    filter->pg_references[DISPLAY_1080P][CRYPTO] = pixReadMemBmp(game_crypto_bmp, game_crypto_bmp_size);
-    filter->pg_references[DISPLAY_1080P][REVENANT] = pixReadMemBmp(game_revenant_bmp, game_revenant_bmp_size);
-    filter->pg_references[DISPLAY_1080P][LOBA] = pixReadMemBmp(game_loba_bmp, game_loba_bmp_size);
-    filter->pg_references[DISPLAY_1080P][RAMPART] = pixReadMemBmp(game_rampart_bmp, game_rampart_bmp_size);
-    filter->pg_references[DISPLAY_1080P][HORIZON] = pixReadMemBmp(game_horizon_bmp, game_horizon_bmp_size);
-    filter->pg_references[DISPLAY_1080P][FUSE] = pixReadMemBmp(game_fuse_bmp, game_fuse_bmp_size);
-    filter->pg_references[DISPLAY_1080P][VALKYRIE] = pixReadMemBmp(game_valkyrie_bmp, game_valkyrie_bmp_size);
-    filter->pg_references[DISPLAY_1080P][SEER] = pixReadMemBmp(game_seer_bmp, game_seer_bmp_size);
-    filter->pg_references[DISPLAY_1080P][ASH] = pixReadMemBmp(game_ash_bmp, game_ash_bmp_size);
-    filter->pg_references[DISPLAY_1080P][MADMAGGIE] = pixReadMemBmp(game_madmaggie_bmp, game_madmaggie_bmp_size);
-    filter->pg_references[DISPLAY_1080P][NEWCASTLE] = pixReadMemBmp(game_newcastle_bmp, game_newcastle_bmp_size);
-    filter->pg_references[DISPLAY_1080P][VANTAGE] = pixReadMemBmp(game_vantage_bmp, game_vantage_bmp_size);
-    filter->pg_references[DISPLAY_1080P][CATALYST] = pixReadMemBmp(game_catalyst_bmp, game_catalyst_bmp_size);
-    filter->pg_references[DISPLAY_1080P][BALLISTIC] = pixReadMemBmp(game_ballistic_bmp, game_ballistic_bmp_size);
-}
-
-static void load_2k_references(apex_game_filter_context_t *filter)
-{
-    filter->banner_references[DISPLAY_2K][MAP_GAME_BUTTON] = pixReadMemBmp(ref_game_map_2k_bmp, ref_game_map_2k_bmp_size);
-    filter->banner_references[DISPLAY_2K][GRENADE_GAME_BUTTON] = pixReadMemBmp(ref_game_grenade_2k_bmp, ref_game_grenade_2k_bmp_size);
-    filter->banner_references[DISPLAY_2K][ESC_LOOTING_BUTTON] = pixReadMemBmp(ref_looting_2k_bmp, ref_looting_2k_bmp_size);
-    filter->banner_references[DISPLAY_2K][ESC_INVENTORY_BUTTON] = pixReadMemBmp(ref_inventory_2k_bmp, ref_inventory_2k_bmp_size);
-    filter->banner_references[DISPLAY_2K][GRAYBAR_INVENTORY_BUTTON] = pixReadMemBmp(ref_graybar_inventory_2k_bmp, ref_graybar_inventory_2k_bmp_size);
-    filter->banner_references[DISPLAY_2K][M_MAP_BUTTON] = pixReadMemBmp(ref_map_2k_bmp, ref_map_2k_bmp_size);
-    filter->banner_references[DISPLAY_2K][PAD_MAP_BUTTON] = pixReadMemBmp(ref_pad_map_2k_bmp, ref_pad_map_2k_bmp_size);
-    filter->banner_references[DISPLAY_2K][PAD_LOOTING_BUTTON] = pixReadMemBmp(ref_pad_looting_2k_bmp, ref_pad_looting_2k_bmp_size);
-    filter->banner_references[DISPLAY_2K][PAD_INVENTORY_BUTTON] = pixReadMemBmp(ref_pad_inventory_2k_bmp, ref_pad_inventory_2k_bmp_size);
-    filter->banner_references[DISPLAY_2K][PAD_TACTICAL_BUTTON] = pixReadMemBmp(ref_pad_tactical_2k_bmp, ref_pad_tactical_2k_bmp_size);
-    filter->banner_references[DISPLAY_2K][SPECTATE_IMAGE_RED] = pixReadMemBmp(ref_spectate_red_2k_bmp, ref_spectate_red_2k_bmp_size);
-    filter->banner_references[DISPLAY_2K][SPECTATE_IMAGE_GREEN] = pixReadMemBmp(ref_spectate_green_2k_bmp, ref_spectate_green_2k_bmp_size);
-    filter->banner_references[DISPLAY_2K][SPECTATE_IMAGE_ORANGE] = pixReadMemBmp(ref_spectate_orange_2k_bmp, ref_spectate_orange_2k_bmp_size);
-    filter->banner_references[DISPLAY_2K][SPECTATE_IMAGE_BLUE] = pixReadMemBmp(ref_spectate_blue_2k_bmp, ref_spectate_blue_2k_bmp_size);
-
-    filter->pg_references[DISPLAY_2K][BLOODHOUND] = pixReadMemBmp(game_bloodhound_2k_bmp, game_bloodhound_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][GIBRALTAR] = pixReadMemBmp(game_gibraltar_2k_bmp, game_gibraltar_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][LIFELINE] = pixReadMemBmp(game_lifeline_2k_bmp, game_lifeline_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][PATHFINDER] = pixReadMemBmp(game_pathfinder_2k_bmp, game_pathfinder_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][WRAITH] = pixReadMemBmp(game_wraith_2k_bmp, game_wraith_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][BANGALORE] = pixReadMemBmp(game_bangalore_2k_bmp, game_bangalore_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][CAUSTIC] = pixReadMemBmp(game_caustic_2k_bmp, game_caustic_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][MIRAGE] = pixReadMemBmp(game_mirage_2k_bmp, game_mirage_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][OCTANE] = pixReadMemBmp(game_octane_2k_bmp, game_octane_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][WATTSON] = pixReadMemBmp(game_wattson_2k_bmp, game_wattson_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][CRYPTO] = pixReadMemBmp(game_crypto_2k_bmp, game_crypto_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][REVENANT] = pixReadMemBmp(game_revenant_2k_bmp, game_revenant_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][LOBA] = pixReadMemBmp(game_loba_2k_bmp, game_loba_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][RAMPART] = pixReadMemBmp(game_rampart_2k_bmp, game_rampart_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][HORIZON] = pixReadMemBmp(game_horizon_2k_bmp, game_horizon_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][FUSE] = pixReadMemBmp(game_fuse_2k_bmp, game_fuse_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][VALKYRIE] = pixReadMemBmp(game_valkyrie_2k_bmp, game_valkyrie_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][SEER] = pixReadMemBmp(game_seer_2k_bmp, game_seer_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][ASH] = pixReadMemBmp(game_ash_2k_bmp, game_ash_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][MADMAGGIE] = pixReadMemBmp(game_madmaggie_2k_bmp, game_madmaggie_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][NEWCASTLE] = pixReadMemBmp(game_newcastle_2k_bmp, game_newcastle_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][VANTAGE] = pixReadMemBmp(game_vantage_2k_bmp, game_vantage_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][CATALYST] = pixReadMemBmp(game_catalyst_2k_bmp, game_catalyst_2k_bmp_size);
-    filter->pg_references[DISPLAY_2K][BALLISTIC] = pixReadMemBmp(game_ballistic_2k_bmp, game_ballistic_2k_bmp_size);
+    obs_data_set_default_bool(settings, "threaded_detection", true);
+    obs_data_set_default_bool(settings, "shared_detection", true);
+    obs_data_set_default_string(settings, "layout_pack", "");
+
+    char *debug_path = obs_module_config_path("debug");
+    obs_data_set_default_string(settings, "debug_path", debug_path);
+    bfree(debug_path);
+
+    char *record_path = obs_module_config_path("recordings");
+    obs_data_set_default_string(settings, "record_mode", record_mode_str[RECORD_OFF]);
+    obs_data_set_default_string(settings, "record_path", record_path);
+    obs_data_set_default_int(settings, "record_interval", 1);
+    obs_data_set_default_bool(settings, "record_compress", true);
+    bfree(record_path);
+
+    obs_data_set_default_int(settings, "debounce_enter_frames", 2);
+    obs_data_set_default_int(settings, "debounce_exit_frames", 3);
+    obs_data_set_default_double(settings, "debounce_hysteresis", 0.25);
+
+    for (area_name_t an = 0; an < AREAS_NUM; an++) {
+        char key[64];
+
+        snprintf(key, sizeof(key), "metric_%s", area_name_str[an]);
+
+        obs_data_set_default_string(settings, key, match_metric_str[default_area_metrics[an]]);
+    }
 }
 
-static void *apex_game_filter_create(obs_data_t *settings, obs_source_t *source)
+static apex_game_filter_context_t *filter_create(obs_data_t *settings, obs_source_t *source, bool async)
 {
-    binfo("creating new filter");
+    binfo("creating new filter%s", async ? " (async)" : "");
 
     apex_game_filter_context_t *filter = bzalloc(sizeof(apex_game_filter_context_t));
 
     filter->source = source;
-    filter->texrender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+    filter->async = async;
+
+    if (!async)
+        filter->texrender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+
+    pthread_mutex_init(&filter->layout_mutex, NULL);
+    pthread_mutex_init(&filter->debug_mutex, NULL);
+    pthread_mutex_init(&filter->state_mutex, NULL);
+    pthread_mutex_init(&filter->target_mutex, NULL);
+
+    filter->recorder = frame_recorder_create();
+
+    filter->result.character = CHARACTERS_NUM;
+    filter->result.spectate_color = SPECTATE_COLORS_NUM;
+
+    filter->state.character = CHARACTERS_NUM;
+    filter->state.spectate_color = SPECTATE_COLORS_NUM;
+
+    signal_handler_add_array(obs_source_get_signal_handler(source), hud_signals);
 
-    filter->image = pixCreate(2560, 1440, 32);
+    proc_handler_add(obs_source_get_proc_handler(source),
+                     "void get_hud_state(out int banners, out string hud, out int character, out string character_name, "
+                     "out int spectate_color, out string spectate_color_name, out int timestamp)",
+                     get_hud_state_proc, filter);
 
-    load_1080p_references(filter);
-    load_2k_references(filter);
+    latency_stats_init(&filter->latency_stats);
+
+    proc_handler_add(obs_source_get_proc_handler(source), "void get_latency(in bool reset, out string latency)", get_latency_proc, filter);
+    proc_handler_add(obs_source_get_proc_handler(source), "void get_debounce(out string debounce)", get_debounce_proc, filter);
+
+    worker_group_init(&filter->detection);
+    worker_group_init(&filter->detectors);
 
     filter->debug_mode = false;
     filter->debug_counter = 0;
@@ -1204,11 +4214,32 @@ static void *apex_game_filter_create(obs_data_t *settings, obs_source_t *source)
 
     apex_game_filter_update(filter, settings);
 
+    for (size_t i = 0; i < sizeof(target_source_signals) / sizeof(target_source_signals[0]); i++)
+        signal_handler_connect(obs_get_signal_handler(), target_source_signals[i], target_source_signal, filter);
+
+    apply_pending_layout(filter);
+    apply_pending_settings(filter);
+
+    if (!filter->layout)
+        filter->layout = layout_create_default();
+
+    return filter;
+}
+
+static void *apex_game_filter_create(obs_data_t *settings, obs_source_t *source)
+{
+    apex_game_filter_context_t *filter = filter_create(settings, source, false);
+
     obs_add_main_render_callback(apex_game_filter_offscreen_render, filter);
 
     return filter;
 }
 
+static void *apex_game_async_filter_create(obs_data_t *settings, obs_source_t *source)
+{
+    return filter_create(settings, source, true);
+}
+
 static release_source(obs_weak_source_t *weak_source)
 {
     if (weak_source)
@@ -1228,30 +4259,61 @@ static void apex_game_filter_destroy(void *data)
 
     filter->closing = true;
 
-    pixDestroy(&filter->image);
+    for (size_t i = 0; i < sizeof(target_source_signals) / sizeof(target_source_signals[0]); i++)
+        signal_handler_disconnect(obs_get_signal_handler(), target_source_signals[i], target_source_signal, filter);
 
-    for (enum display_resolution ds = 0; ds < DISPLAY_RESOLUTIONS; ds++)
-        for (enum area_name an = 0; an < AREAS_NUM; an++)
-            pixDestroy(&filter->banner_references[ds][an]);
+    if (!filter->async)
+        obs_remove_main_render_callback(apex_game_filter_offscreen_render, filter);
 
-    for (enum display_resolution ds = 0; ds < DISPLAY_RESOLUTIONS; ds++)
-        for (character_name_t pg = 0; pg < CHARACTERS_NUM; pg++)
-            pixDestroy(&filter->pg_references[ds][pg]);
+    worker_group_wait(detection_pool, &filter->detection);
+    worker_group_free(&filter->detection);
+    worker_group_free(&filter->detectors);
+
+    leave_detection_cache(filter);
+
+    frame_recorder_destroy(filter->recorder);
+    bfree(filter->record_path);
+
+    hud_export_destroy(filter->export);
+    bfree(filter->export_name);
+
+    latency_stats_free(&filter->latency_stats);
+
+    if (filter->image)
+        pixSetData(filter->image, NULL);
+
+    pixDestroy(&filter->image);
+    work_arena_free(&filter->work);
+
+    layout_destroy(filter->layout);
+    layout_destroy(filter->pending_layout);
+    pthread_mutex_destroy(&filter->layout_mutex);
+    pthread_mutex_destroy(&filter->debug_mutex);
+    pthread_mutex_destroy(&filter->state_mutex);
+    bfree(filter->layout_path);
+
+    for (banner_position_t bp = 0; bp < BANNER_POSITION_NUM; bp++) {
+        release_source(filter->target_sources[bp]);
+        bfree(filter->target_names[bp]);
+    }
 
-    obs_remove_main_render_callback(apex_game_filter_offscreen_render, filter);
+    pthread_mutex_destroy(&filter->target_mutex);
 
-    release_source(filter->target_sources[BANNER_GAME]);
-    release_source(filter->target_sources[BANNER_LOOTING]);
-    release_source(filter->target_sources[BANNER_INVENTORY]);
-    release_source(filter->target_sources[BANNER_MAP]);
+    if (!filter->async) {
+        obs_enter_graphics();
 
-    obs_enter_graphics();
+        unmap_frame(filter);
+
+        gs_stagesurface_destroy(filter->stagesurface);
+        gs_texrender_destroy(filter->texrender);
 
-    gs_stagesurface_unmap(filter->stagesurface);
-    gs_stagesurface_destroy(filter->stagesurface);
-    gs_texrender_destroy(filter->texrender);
+        for (enum render_region rr = 0; rr < RENDER_REGIONS_NUM; rr++) {
+            gs_stagesurface_destroy(filter->region_stagesurfaces[rr]);
+            gs_texrender_destroy(filter->region_texrenders[rr]);
+        }
 
-    obs_leave_graphics();
+        obs_leave_graphics();
+    }
 
     bfree(filter);
 }
@@ -1265,6 +4327,21 @@ static void apex_game_filter_tick(void *data, float seconds)
     if (filter->closing)
         return;
 
+    worker_group_wait(detection_pool, &filter->detection);
+
+    apply_pending_layout(filter);
+    apply_pending_settings(filter);
+    refresh_target_sources(filter);
+
+    if (filter->result_ready) {
+        apply_result(filter);
+        filter->result_ready = false;
+    }
+
+    /* a frame detected by another filter on a worker thread */
+    if (obs_source_enabled(filter->source))
+        follow_detection(filter);
+
     obs_source_t *parent = obs_filter_get_parent(filter->source);
 
     if (!parent)
@@ -1276,19 +4353,7 @@ static void apex_game_filter_tick(void *data, float seconds)
     width += (width & 1);
     height += (height & 1);
 
-    if (filter->width != width || filter->height != height) {
-        filter->width = width;
-        filter->height = height;
-
-        if (filter->width == 1920 && filter->height == 1080)
-            filter->display = DISPLAY_1080P;
-        else if (filter->width == 2560 && filter->height == 1440)
-            filter->display = DISPLAY_2K;
-        else
-            filter->display = DISPLAY_RESOLUTIONS;
-
-        binfo("new size, %dx%d, display %d", width, height, filter->display);
-    }
+    set_frame_size(filter, width, height);
 }
 
 static bool list_add_sources(void *data, obs_source_t *source)
@@ -1306,6 +4371,44 @@ static bool list_add_sources(void *data, obs_source_t *source)
     return true;
 }
 
+static bool reload_layout_clicked(obs_properties_t *props, obs_property_t *property, void *data)
+{
+    UNUSED_PARAMETER(props);
+    UNUSED_PARAMETER(property);
+
+    apex_game_filter_context_t *filter = data;
+
+    queue_layout(filter);
+
+    return false;
+}
+
+static bool export_layout_clicked(obs_properties_t *props, obs_property_t *property, void *data)
+{
+    UNUSED_PARAMETER(props);
+    UNUSED_PARAMETER(property);
+    UNUSED_PARAMETER(data);
+
+    char *dir = obs_module_config_path("");
+    char *path = obs_module_config_path("default." LAYOUT_PACK_EXTENSION);
+
+    os_mkdirs(dir);
+
+    struct layout *l = layout_create_default();
+
+    if (layout_write(l, path))
+        binfo("default layout pack exported to %s", path);
+    else
+        bwarn("unable to export the default layout pack to %s", path);
+
+    layout_destroy(l);
+
+    bfree(path);
+    bfree(dir);
+
+    return false;
+}
+
 static obs_properties_t *apex_game_filter_properties(void *data)
 {
     apex_game_filter_context_t *filter = data;
@@ -1319,10 +4422,12 @@ static obs_properties_t *apex_game_filter_properties(void *data)
     obs_properties_add_group(props, "game_settin", "Game settings", OBS_GROUP_NORMAL, group_1);
 
     p = obs_properties_add_list(group_1, "game_input", "Input device", OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+    obs_property_list_add_string(p, "Automatic", "auto");
     obs_property_list_add_string(p, "Mouse and Keyboard", "mk");
     obs_property_list_add_string(p, "PlayStation Pad", "ps-pad");
 
     p = obs_properties_add_list(group_1, "game_lang", "Game Language", OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+    obs_property_list_add_string(p, "Automatic", "auto");
     obs_property_list_add_string(p, "Italiano", "it");
     obs_property_list_add_string(p, "English", "en");
     obs_property_list_add_string(p, "简体中文", "zh");
@@ -1344,7 +4449,69 @@ static obs_properties_t *apex_game_filter_properties(void *data)
     p = obs_properties_add_list(group_2, "spectate_source", "Spectate Source", OBS_COMBO_TYPE_EDITABLE, OBS_COMBO_FORMAT_STRING);
     obs_enum_sources(list_add_sources, p);
 
+    obs_properties_t *group_3 = obs_properties_create();
+
+    obs_properties_add_group(props, "matching", "Matching metrics", OBS_GROUP_NORMAL, group_3);
+
+    for (area_name_t an = 0; an < AREAS_NUM; an++) {
+        char key[64];
+
+        if (an == SPECTATE_IMAGE_RED || an == SPECTATE_IMAGE_GREEN || an == SPECTATE_IMAGE_ORANGE || an == SPECTATE_IMAGE_BLUE)
+            continue;
+
+        /* the counters are only watched for changes */
+        if (an == SQUADS_LEFT_IMAGE || an == KILL_COUNT_IMAGE)
+            continue;
+
+        snprintf(key, sizeof(key), "metric_%s", area_name_str[an]);
+
+        p = obs_properties_add_list(group_3, key, area_name_str[an], OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+        obs_property_list_add_string(p, "PSNR", match_metric_str[METRIC_PSNR]);
+        obs_property_list_add_string(p, "Luma NCC", match_metric_str[METRIC_LUMA_NCC]);
+        obs_property_list_add_string(p, "Glyph mask", match_metric_str[METRIC_GLYPH_MASK]);
+    }
+
+    obs_properties_t *group_4 = obs_properties_create();
+
+    obs_properties_add_group(props, "layout", "HUD layout", OBS_GROUP_NORMAL, group_4);
+
+    obs_properties_add_path(group_4, "layout_pack", "Layout pack (empty for built-in)", OBS_PATH_FILE, "Layout pack (*." LAYOUT_PACK_EXTENSION ")", NULL);
+    obs_properties_add_button(group_4, "reload_layout", "Reload layout pack", reload_layout_clicked);
+    obs_properties_add_button(group_4, "export_layout", "Export built-in layout pack", export_layout_clicked);
+
+    obs_properties_t *group_5 = obs_properties_create();
+
+    obs_properties_add_group(props, "recording", "Recording", OBS_GROUP_NORMAL, group_5);
+
+    p = obs_properties_add_list(group_5, "record_mode", "Record", OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+    obs_property_list_add_string(p, "Off", record_mode_str[RECORD_OFF]);
+    obs_property_list_add_string(p, "HUD areas", record_mode_str[RECORD_AREAS]);
+    obs_property_list_add_string(p, "Full frames", record_mode_str[RECORD_FRAMES]);
+
+    obs_properties_add_int(group_5, "record_interval", "Record one frame every", 1, 3600, 1);
+    obs_properties_add_bool(group_5, "record_compress", "Compress records (LZ4)");
+    obs_properties_add_path(group_5, "record_path", "Recordings directory", OBS_PATH_DIRECTORY, NULL, NULL);
+
+    obs_properties_t *group_6 = obs_properties_create();
+
+    obs_properties_add_group(props, "export", "Shared memory export", OBS_GROUP_NORMAL, group_6);
+
+    obs_properties_add_text(group_6, "export_name", "Segment name (empty to disable)", OBS_TEXT_DEFAULT);
+
+    obs_properties_t *group_7 = obs_properties_create();
+
+    obs_properties_add_group(props, "debounce", "Debounce", OBS_GROUP_NORMAL, group_7);
+
+    obs_properties_add_int(group_7, "debounce_enter_frames", "Frames to show a banner", 1, 60, 1);
+    obs_properties_add_int(group_7, "debounce_exit_frames", "Frames to hide a banner", 1, 60, 1);
+    obs_properties_add_float(group_7, "debounce_hysteresis", "Confidence hysteresis", 0.0, 1.0, 0.05);
+
+    obs_properties_add_bool(props, "threaded_detection", "Run detection on worker threads");
+    obs_properties_add_bool(props, "parallel_detectors", "Evaluate HUD detectors in parallel");
+    obs_properties_add_bool(props, "region_render", "Render only the HUD regions");
+    obs_properties_add_bool(props, "shared_detection", "Share the detection with the other filters on the same source");
     obs_properties_add_bool(props, "debug_mode", "Enable debug messages");
+    obs_properties_add_path(props, "debug_path", "Debug captures directory", OBS_PATH_DIRECTORY, NULL, NULL);
 
     return props;
 }
@@ -1366,7 +4533,8 @@ static void apex_game_filter_filter_remove(void *data, obs_source_t *parent)
 
     filter->closing = true;
 
-    obs_remove_main_render_callback(apex_game_filter_offscreen_render, filter);
+    if (!filter->async)
+        obs_remove_main_render_callback(apex_game_filter_offscreen_render, filter);
 }
 
 struct obs_source_info apex_game_filter_info = {
@@ -1385,6 +4553,21 @@ struct obs_source_info apex_game_filter_info = {
     .filter_remove = apex_game_filter_filter_remove,
 };
 
+struct obs_source_info apex_game_async_filter_info = {
+    .id = "apex_game_async_filter",
+    .type = OBS_SOURCE_TYPE_FILTER,
+    .output_flags = OBS_SOURCE_ASYNC_VIDEO,
+    .get_name = apex_game_async_filter_get_name,
+    .create = apex_game_async_filter_create,
+    .destroy = apex_game_filter_destroy,
+    .update = apex_game_filter_update,
+    .load = apex_game_filter_update,
+    .get_defaults = apex_game_filter_defaults,
+    .filter_video = apex_game_filter_video,
+    .get_properties = apex_game_filter_properties,
+    .filter_remove = apex_game_filter_filter_remove,
+};
+
 OBS_DECLARE_MODULE()
 
 MODULE_EXPORT const char *obs_module_description(void)
@@ -1396,7 +4579,16 @@ bool obs_module_load(void)
 {
     binfo("loaded version %s", PROJECT_VERSION);
 
+    detection_pool = worker_pool_create(os_get_logical_cores() - 1);
+
+    binfo("detection pool with %d workers", worker_pool_size(detection_pool));
+
+    debug_writer = debug_writer_create();
+
+    detection_cache = detection_cache_create();
+
     obs_register_source(&apex_game_filter_info);
+    obs_register_source(&apex_game_async_filter_info);
 
     return true;
 }
@@ -1409,4 +4601,13 @@ void obs_module_post_load(void)
 void obs_module_unload(void)
 {
     binfo("module unloading");
+
+    worker_pool_destroy(detection_pool);
+    detection_pool = NULL;
+
+    debug_writer_destroy(debug_writer);
+    debug_writer = NULL;
+
+    detection_cache_destroy(detection_cache);
+    detection_cache = NULL;
 }
@@ -0,0 +1,291 @@
+#include <math.h>
+#include <string.h>
+
+#include "area-prefilter.h"
+
+/* slack for the rounding of the bounds, they are compared with float thresholds */
+#define SSD_BOUND_EPSILON   1e-6
+#define NCC_BOUND_EPSILON   1e-4
+
+static uint32_t pixel_luma(uint32_t pixel)
+{
+    uint32_t r = pixel >> 24, g = (pixel >> 16) & 0xff, b = (pixel >> 8) & 0xff;
+
+    return (77 * r + 150 * g + 29 * b) >> 8;
+}
+
+static void pixel_channels(uint32_t pixel, uint32_t values[PREFILTER_CHANNELS_NUM])
+{
+    values[PREFILTER_RED] = pixel >> 24;
+    values[PREFILTER_GREEN] = (pixel >> 16) & 0xff;
+    values[PREFILTER_BLUE] = (pixel >> 8) & 0xff;
+    values[PREFILTER_LUMA] = pixel_luma(pixel);
+    values[PREFILTER_LUMA_SQUARED] = values[PREFILTER_LUMA] * values[PREFILTER_LUMA];
+}
+
+/*
+ * the cells of level l are the 2^l x 2^l grid of the area, stored after the
+ * cells of the previous levels
+ */
+static void cell_bounds(uint32_t w, uint32_t h, int level, int index, struct prefilter_cell *cell)
+{
+    uint32_t grid = 1u << level;
+    uint32_t cx = index % grid, cy = index / grid;
+
+    cell->x = w * cx / grid;
+    cell->y = h * cy / grid;
+    cell->w = w * (cx + 1) / grid - cell->x;
+    cell->h = h * (cy + 1) / grid - cell->y;
+}
+
+static int level_first_cell(int level)
+{
+    return ((1 << (2 * level)) - 1) / 3;
+}
+
+void prefilter_reference_init(struct prefilter_reference *ref, const uint32_t *pixels, uint32_t wpl, uint32_t w, uint32_t h, uint32_t mask_min_luma)
+{
+    uint64_t masked = 0, masked_sum = 0, masked_squares = 0;
+
+    memset(ref, 0, sizeof(*ref));
+
+    ref->w = w;
+    ref->h = h;
+
+    for (uint32_t y = 0; y < h; y++) {
+        for (uint32_t x = 0; x < w; x++) {
+            uint32_t luma = pixel_luma(pixels[y * wpl + x]);
+
+            if (luma < mask_min_luma)
+                continue;
+
+            masked++;
+            masked_sum += luma;
+            masked_squares += luma * luma;
+        }
+    }
+
+    ref->unmasked = w * h - (uint32_t)masked;
+    ref->luma_mean = masked ? (double)masked_sum / masked : 0.0;
+    ref->luma_ss = masked ? (double)masked_squares - (double)masked_sum * ref->luma_mean : 0.0;
+
+    for (int level = 0; level < PREFILTER_LEVELS; level++) {
+        for (int i = 0; i < (1 << (2 * level)); i++) {
+            struct prefilter_cell *cell = &ref->cells[level_first_cell(level) + i];
+            uint64_t sums[PREFILTER_CHANNELS_NUM] = { 0 };
+            uint32_t values[PREFILTER_CHANNELS_NUM];
+            uint32_t n = 0;
+
+            cell_bounds(w, h, level, i, cell);
+
+            masked = masked_sum = masked_squares = 0;
+
+            for (uint32_t y = cell->y; y < cell->y + cell->h; y++) {
+                for (uint32_t x = cell->x; x < cell->x + cell->w; x++) {
+                    pixel_channels(pixels[y * wpl + x], values);
+
+                    for (int c = PREFILTER_RED; c <= PREFILTER_BLUE; c++)
+                        sums[c] += values[c];
+
+                    n++;
+
+                    if (values[PREFILTER_LUMA] < mask_min_luma)
+                        continue;
+
+                    masked++;
+                    masked_sum += values[PREFILTER_LUMA];
+                    masked_squares += values[PREFILTER_LUMA_SQUARED];
+                }
+            }
+
+            if (!n)
+                continue;
+
+            for (int c = PREFILTER_RED; c <= PREFILTER_BLUE; c++)
+                cell->mean[c] = (double)sums[c] / n;
+
+            cell->unmasked = n - (uint32_t)masked;
+            cell->luma_mean = masked ? (double)masked_sum / masked : 0.0;
+            cell->luma_ss = masked ? (double)masked_squares - (double)masked_sum * cell->luma_mean : 0.0;
+        }
+    }
+}
+
+void prefilter_frame_build(struct prefilter_frame *frame, const uint32_t *pixels, uint32_t wpl, uint32_t x, uint32_t y, uint32_t w, uint32_t h)
+{
+    const size_t stride = (size_t)(w + 1) * PREFILTER_CHANNELS_NUM;
+    uint64_t *sat = frame->sat;
+    uint32_t values[PREFILTER_CHANNELS_NUM];
+
+    frame->w = w;
+    frame->h = h;
+
+    memset(sat, 0, stride * sizeof(uint64_t));
+
+    for (uint32_t row = 0; row < h; row++) {
+        const uint32_t *line = pixels + (size_t)(y + row) * wpl + x;
+        uint64_t *above = sat + row * stride;
+        uint64_t *current = above + stride;
+        uint64_t running[PREFILTER_CHANNELS_NUM] = { 0 };
+
+        memset(current, 0, PREFILTER_CHANNELS_NUM * sizeof(uint64_t));
+
+        for (uint32_t col = 0; col < w; col++) {
+            pixel_channels(line[col], values);
+
+            for (int c = 0; c < PREFILTER_CHANNELS_NUM; c++) {
+                running[c] += values[c];
+                current[(col + 1) * PREFILTER_CHANNELS_NUM + c] = above[(col + 1) * PREFILTER_CHANNELS_NUM + c] + running[c];
+            }
+        }
+    }
+}
+
+static double box_sum(const struct prefilter_frame *frame, const struct prefilter_cell *cell, int channel)
+{
+    const size_t stride = (size_t)(frame->w + 1) * PREFILTER_CHANNELS_NUM;
+    const uint64_t *top = frame->sat + cell->y * stride;
+    const uint64_t *bottom = frame->sat + (cell->y + cell->h) * stride;
+    size_t left = (size_t)cell->x * PREFILTER_CHANNELS_NUM + channel;
+    size_t right = (size_t)(cell->x + cell->w) * PREFILTER_CHANNELS_NUM + channel;
+
+    return (double)(bottom[right] - bottom[left] - top[right] + top[left]);
+}
+
+static bool sizes_match(const struct prefilter_frame *frame, const struct prefilter_reference *ref)
+{
+    return frame->sat && ref->w && frame->w == ref->w && frame->h == ref->h;
+}
+
+/*
+ * the squared error of a cell is at least the one of its mean colour, the
+ * bound of the error grows with the number of cells
+ */
+int prefilter_reject_ssd(const struct prefilter_frame *frame, const struct prefilter_reference *ref, double max_ssd, double *bound)
+{
+    *bound = 0.0;
+
+    if (!sizes_match(frame, ref))
+        return -1;
+
+    for (int level = 0; level < PREFILTER_LEVELS; level++) {
+        double error = 0.0;
+
+        for (int i = 0; i < (1 << (2 * level)); i++) {
+            const struct prefilter_cell *cell = &ref->cells[level_first_cell(level) + i];
+            double n = (double)cell->w * cell->h;
+
+            if (!n)
+                continue;
+
+            for (int c = PREFILTER_RED; c <= PREFILTER_BLUE; c++) {
+                double d = box_sum(frame, cell, c) / n - cell->mean[c];
+
+                error += n * d * d;
+            }
+        }
+
+        *bound = error;
+
+        if (error * (1.0 - SSD_BOUND_EPSILON) >= max_ssd)
+            return level;
+    }
+
+    return -1;
+}
+
+/*
+ * sums of the luma of the area over a set of cells, the variance of the
+ * masked pixels is at least the one seen through the cells
+ */
+struct luma_sums
+{
+    double n;
+    double sum;
+    double within;
+    double means;
+};
+
+static void add_luma_sums(struct luma_sums *sums, double n, double sum, double ss)
+{
+    sums->n += n;
+    sums->sum += sum;
+    sums->within += ss;
+    sums->means += sum * sum / n;
+}
+
+static double luma_variance(const struct luma_sums *sums)
+{
+    return sums->n ? sums->within + sums->means - sums->sum * sums->sum / sums->n : 0.0;
+}
+
+/*
+ * in every cell the covariance of the masked pixels is bounded by
+ * cauchy-schwarz around the cell means, plus the term of the cell mean of the
+ * reference that depends on the (unknown) masked sum of the area: it is
+ * between the sum of the cell minus 255 per unmasked pixel and the sum of the
+ * cell.
+ *
+ * the variance is bounded either through the solid cells only or through all
+ * the cells minus the largest contribution of the unmasked pixels.
+ */
+int prefilter_reject_ncc(const struct prefilter_frame *frame, const struct prefilter_reference *ref, float threshold, float *bound)
+{
+    *bound = 1.0f;
+
+    if (!sizes_match(frame, ref) || ref->luma_ss <= 0.0)
+        return -1;
+
+    for (int level = 0; level < PREFILTER_LEVELS; level++) {
+        struct luma_sums all = { 0 }, solid = { 0 };
+        double covariance = 0.0;
+
+        for (int i = 0; i < (1 << (2 * level)); i++) {
+            const struct prefilter_cell *cell = &ref->cells[level_first_cell(level) + i];
+            double n = (double)cell->w * cell->h;
+
+            if (!n)
+                continue;
+
+            double sum = box_sum(frame, cell, PREFILTER_LUMA);
+            double ss = box_sum(frame, cell, PREFILTER_LUMA_SQUARED) - sum * sum / n;
+
+            if (ss < 0.0)
+                ss = 0.0;
+
+            add_luma_sums(&all, n, sum, ss);
+
+            if (!cell->unmasked)
+                add_luma_sums(&solid, n, sum, ss);
+
+            if (cell->unmasked == n)
+                continue;
+
+            double delta = cell->luma_mean - ref->luma_mean;
+            double masked_sum = delta > 0.0 ? sum : sum - 255.0 * cell->unmasked;
+
+            if (masked_sum < 0.0)
+                masked_sum = 0.0;
+
+            covariance += sqrt(ss * cell->luma_ss) + delta * masked_sum;
+        }
+
+        double variance = luma_variance(&all) - 255.0 * 255.0 * ref->unmasked;
+        double solid_variance = luma_variance(&solid);
+
+        if (solid_variance > variance)
+            variance = solid_variance;
+
+        if (covariance <= 0.0)
+            *bound = 0.0f;
+        else if (variance > 0.0)
+            *bound = (float)(covariance / sqrt(variance * ref->luma_ss));
+        else
+            continue;
+
+        if (*bound + NCC_BOUND_EPSILON <= threshold)
+            return level;
+    }
+
+    return -1;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * reject cascade run before the full comparison of an area with many
+ * candidate references (ie. the character banner).
+ *
+ * the summed-area tables of the area are built once per frame, the statistics
+ * of the references once per layout. every level splits the area in a finer
+ * grid of cells (1x1, 2x2, 4x4) and computes from the cell sums a bound of
+ * the score the full comparison can reach: a reference whose bound is on the
+ * wrong side of the threshold cannot match and is skipped. the bounds never
+ * reject a reference that would have matched.
+ *
+ * pixels are leptonica 32 bpp words (r << 24 | g << 16 | b << 8).
+ */
+
+#define PREFILTER_LEVELS    3
+#define PREFILTER_CELLS     (1 + 4 + 16)
+
+enum prefilter_channel
+{
+    PREFILTER_RED,
+    PREFILTER_GREEN,
+    PREFILTER_BLUE,
+    PREFILTER_LUMA,
+    PREFILTER_LUMA_SQUARED,
+
+    PREFILTER_CHANNELS_NUM
+};
+
+struct prefilter_cell
+{
+    uint32_t x;
+    uint32_t y;
+    uint32_t w;
+    uint32_t h;
+    uint32_t unmasked;                      /* pixels out of the luma mask */
+    double mean[PREFILTER_BLUE + 1];        /* colour means of all the pixels */
+    double luma_mean;                       /* luma mean of the masked pixels */
+    double luma_ss;                         /* sum of squared deviations from it */
+};
+
+struct prefilter_reference
+{
+    uint32_t w;
+    uint32_t h;
+    uint32_t unmasked;
+    struct prefilter_cell cells[PREFILTER_CELLS];
+    double luma_mean;
+    double luma_ss;
+};
+
+/*
+ * sat is owned by the caller and holds prefilter_sat_size(w, h) bytes
+ */
+struct prefilter_frame
+{
+    uint32_t w;
+    uint32_t h;
+    uint64_t *sat;
+};
+
+static inline size_t prefilter_sat_size(uint32_t w, uint32_t h)
+{
+    return (size_t)(w + 1) * (h + 1) * PREFILTER_CHANNELS_NUM * sizeof(uint64_t);
+}
+
+void prefilter_reference_init(struct prefilter_reference *ref, const uint32_t *pixels, uint32_t wpl, uint32_t w, uint32_t h, uint32_t mask_min_luma);
+
+void prefilter_frame_build(struct prefilter_frame *frame, const uint32_t *pixels, uint32_t wpl, uint32_t x, uint32_t y, uint32_t w, uint32_t h);
+
+/*
+ * both return the level that rejected the reference, or -1 when the full
+ * comparison is needed. a match needs a sum of squared differences of the
+ * channels below max_ssd, bound receives its lower bound. for the ncc bound
+ * receives the upper bound of the score.
+ */
+int prefilter_reject_ssd(const struct prefilter_frame *frame, const struct prefilter_reference *ref, double max_ssd, double *bound);
+int prefilter_reject_ncc(const struct prefilter_frame *frame, const struct prefilter_reference *ref, float threshold, float *bound);
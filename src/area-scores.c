@@ -0,0 +1,66 @@
+#include <math.h>
+
+#include "area-scores.h"
+
+void area_reference_planes(uint8_t *red, size_t plane_size, const uint32_t *pixels, uint32_t wpl, uint32_t w, uint32_t h, uint32_t mask_min_luma)
+{
+    uint8_t *green = red + plane_size, *blue = green + plane_size, *luma = blue + plane_size, *mask = luma + plane_size;
+
+    for (uint32_t y = 0; y < h; y++) {
+        const uint32_t *line = pixels + (size_t)y * wpl;
+
+        for (uint32_t x = 0; x < w; x++) {
+            size_t i = (size_t)y * w + x;
+            uint32_t r = line[x] >> 24, g = (line[x] >> 16) & 0xff, b = (line[x] >> 8) & 0xff;
+            uint32_t l = rgb_luma(r, g, b);
+
+            red[i] = r;
+            green[i] = g;
+            blue[i] = b;
+            luma[i] = l;
+            mask[i] = l >= mask_min_luma;
+        }
+    }
+}
+
+float ssd_psnr(uint64_t ssd, uint64_t pixels)
+{
+    if (!ssd)
+        return 1000.0f;
+
+    return (float)(10.0 * log10(3.0 * 255.0 * 255.0 * (double)pixels / (double)ssd));
+}
+
+float area_ncc(const uint32_t *pixels, uint32_t wpl, const uint8_t *luma, const uint8_t *mask, uint32_t w, uint32_t h)
+{
+    int64_t n = 0, sum_i = 0, sum_r = 0, sum_ii = 0, sum_rr = 0, sum_ir = 0;
+
+    for (uint32_t y = 0; y < h; y++) {
+        const uint32_t *line = pixels + (size_t)y * wpl;
+
+        for (uint32_t x = 0; x < w; x++) {
+            size_t i = (size_t)y * w + x;
+
+            if (!mask[i])
+                continue;
+
+            int64_t li = rgb_luma(line[x] >> 24, (line[x] >> 16) & 0xff, (line[x] >> 8) & 0xff);
+            int64_t lr = luma[i];
+
+            n++;
+            sum_i += li;
+            sum_r += lr;
+            sum_ii += li * li;
+            sum_rr += lr * lr;
+            sum_ir += li * lr;
+        }
+    }
+
+    double var_i = (double)(n * sum_ii - sum_i * sum_i);
+    double var_r = (double)(n * sum_rr - sum_r * sum_r);
+
+    if (var_i <= 0.0 || var_r <= 0.0)
+        return 0.0f;
+
+    return (float)((double)(n * sum_ir - sum_i * sum_r) / sqrt(var_i * var_r));
+}
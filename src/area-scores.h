@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * scores of an area against its reference, computed the same way by the
+ * plugin and by the tools. the areas are leptonica 32 bpp words (r << 24 |
+ * g << 16 | b << 8), pixels points at their top left corner. the references
+ * are planar, one byte per pixel and rows of w bytes: red, green, blue, luma
+ * and the mask of the luma (1 where the pixel takes part in the ncc),
+ * plane_size bytes apart. the sum of squared differences is in
+ * ssd-kernels.h.
+ */
+
+enum reference_plane
+{
+    REFERENCE_RED,
+    REFERENCE_GREEN,
+    REFERENCE_BLUE,
+    REFERENCE_LUMA,
+    REFERENCE_MASK,
+
+    REFERENCE_PLANES_NUM
+};
+
+static inline uint32_t rgb_luma(uint32_t r, uint32_t g, uint32_t b)
+{
+    return (77 * r + 150 * g + 29 * b) >> 8;
+}
+
+/*
+ * pixels that are almost black in the reference are the transparent parts of
+ * the HUD where the game shows through, they are out of the mask
+ */
+void area_reference_planes(uint8_t *red, size_t plane_size, const uint32_t *pixels, uint32_t wpl, uint32_t w, uint32_t h, uint32_t mask_min_luma);
+
+/*
+ * same value as pixGetPSNR(), 1000 for identical images
+ */
+float ssd_psnr(uint64_t ssd, uint64_t pixels);
+
+/*
+ * normalized cross-correlation of the luma of the pixels in the mask, 0 when
+ * either side is flat
+ */
+float area_ncc(const uint32_t *pixels, uint32_t wpl, const uint8_t *luma, const uint8_t *mask, uint32_t w, uint32_t h);
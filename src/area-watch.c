@@ -0,0 +1,56 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "area-watch.h"
+
+static uint32_t sample_distance(uint32_t a, uint32_t b)
+{
+    return abs((int)(a >> 24) - (int)(b >> 24)) + abs((int)((a >> 16) & 0xff) - (int)((b >> 16) & 0xff)) +
+           abs((int)((a >> 8) & 0xff) - (int)((b >> 8) & 0xff));
+}
+
+static bool samples_differ(const uint32_t *a, const uint32_t *b, uint32_t count, uint32_t tolerance)
+{
+    for (uint32_t i = 0; i < count; i++)
+        if (sample_distance(a[i], b[i]) > tolerance)
+            return true;
+
+    return false;
+}
+
+void area_watch_reset(struct area_watch *watch)
+{
+    memset(watch, 0, sizeof(*watch));
+}
+
+enum area_watch_event area_watch_update(struct area_watch *watch, const uint32_t *samples, uint32_t count, uint32_t tolerance,
+                                        uint32_t settle_frames)
+{
+    if (count > AREA_WATCH_SAMPLES)
+        count = AREA_WATCH_SAMPLES;
+
+    watch->frames++;
+
+    if (count != watch->count) {
+        watch->count = count;
+        watch->settled_valid = false;
+    } else if (!samples_differ(samples, watch->samples, count, tolerance)) {
+        if (++watch->quiet != settle_frames)
+            return AREA_WATCH_STILL;
+
+        if (watch->settled_valid && !samples_differ(samples, watch->settled, count, tolerance))
+            return AREA_WATCH_SETTLED;
+
+        memcpy(watch->settled, samples, count * sizeof(uint32_t));
+        watch->settled_valid = true;
+        watch->news++;
+
+        return AREA_WATCH_NEW;
+    }
+
+    memcpy(watch->samples, samples, count * sizeof(uint32_t));
+    watch->quiet = 0;
+    watch->changes++;
+
+    return AREA_WATCH_CHANGED;
+}
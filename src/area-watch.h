@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * change test of an area between frames, so that the detectors of the HUD
+ * elements that rarely change (ie. the counters) act only once the content of
+ * their area changed.
+ *
+ * the caller samples the area on a grid of at most AREA_WATCH_GRID x
+ * AREA_WATCH_GRID pixels (every pixel of smaller areas), see
+ * area_watch_grid(). a sample changed when the sum of the differences of its
+ * channels is above the tolerance. the samples are kept from the last change,
+ * a slow drift is caught once it adds up to the tolerance.
+ *
+ * the content is settled when no sample changed for settle_frames frames,
+ * and new when it differs from the previous settled one.
+ */
+
+#define AREA_WATCH_GRID     16
+#define AREA_WATCH_SAMPLES  (AREA_WATCH_GRID * AREA_WATCH_GRID)
+
+enum area_watch_event
+{
+    AREA_WATCH_STILL,       /* nothing changed */
+    AREA_WATCH_CHANGED,     /* the area changed in this frame */
+    AREA_WATCH_SETTLED,     /* settled back on the previous settled content */
+    AREA_WATCH_NEW,         /* settled on a new content, also the first one */
+};
+
+struct area_watch
+{
+    uint32_t count;         /* samples, 0 before the first frame */
+    uint32_t quiet;         /* frames since the last change */
+    bool settled_valid;
+    uint32_t samples[AREA_WATCH_SAMPLES];
+    uint32_t settled[AREA_WATCH_SAMPLES];
+    uint64_t frames;
+    uint64_t changes;
+    uint64_t news;
+};
+
+/*
+ * columns and rows of the sampling grid of a w x h area, sample (i, j) is
+ * pixel (i * w / columns, j * h / rows)
+ */
+static inline void area_watch_grid(uint32_t w, uint32_t h, uint32_t *columns, uint32_t *rows)
+{
+    *columns = w < AREA_WATCH_GRID ? w : AREA_WATCH_GRID;
+    *rows = h < AREA_WATCH_GRID ? h : AREA_WATCH_GRID;
+}
+
+void area_watch_reset(struct area_watch *watch);
+
+/*
+ * samples are r << 24 | g << 16 | b << 8 words, count of them. a change in
+ * the number of samples (the area was resized) is a change of the content.
+ */
+enum area_watch_event area_watch_update(struct area_watch *watch, const uint32_t *samples, uint32_t count, uint32_t tolerance,
+                                        uint32_t settle_frames);
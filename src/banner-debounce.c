@@ -0,0 +1,35 @@
+#include "banner-debounce.h"
+
+bool banner_debouncer_update(struct banner_debouncer *d, const struct debounce_settings *s, bool raw, float confidence)
+{
+    bool wanted, decisive;
+    uint32_t frames;
+
+    if (raw != d->raw) {
+        d->raw = raw;
+        d->raw_flips++;
+    }
+
+    if (d->shown) {
+        wanted = raw || confidence > -s->hysteresis;
+        decisive = !raw && confidence <= -1.0f;
+        frames = s->exit_frames;
+    } else {
+        wanted = raw && confidence > s->hysteresis;
+        decisive = raw && confidence >= 1.0f;
+        frames = s->enter_frames;
+    }
+
+    if (wanted == d->shown) {
+        d->streak = 0;
+        return d->shown;
+    }
+
+    if (++d->streak >= frames || decisive) {
+        d->shown = wanted;
+        d->streak = 0;
+        d->flips++;
+    }
+
+    return d->shown;
+}
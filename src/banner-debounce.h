@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * debounce of the state of a banner on top of the raw detection, so that a
+ * detection sitting near its threshold does not toggle the sources on
+ * consecutive frames.
+ *
+ * the confidence (see compare_area_with_offset()) has to stay beyond the
+ * hysteresis for enter_frames frames to show the banner and for exit_frames
+ * frames to hide it. a decisive detection (confidence from 1, or down to -1
+ * to hide) changes the state at once. enter and exit frames of 1 and a
+ * hysteresis of 0 follow the raw detection.
+ */
+
+struct debounce_settings
+{
+    uint32_t enter_frames;
+    uint32_t exit_frames;
+    float hysteresis;
+};
+
+struct banner_debouncer
+{
+    bool shown;
+    bool raw;
+    uint32_t streak;
+    uint64_t raw_flips;
+    uint64_t flips;
+};
+
+/*
+ * returns the debounced state
+ */
+bool banner_debouncer_update(struct banner_debouncer *d, const struct debounce_settings *s, bool raw, float confidence);
+
+/*
+ * raw flips that never reached the sources
+ */
+static inline uint64_t banner_debouncer_suppressed(const struct banner_debouncer *d)
+{
+    return d->raw_flips > d->flips ? d->raw_flips - d->flips : 0;
+}
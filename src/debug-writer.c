@@ -0,0 +1,190 @@
+#include <obs-module.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include "debug-writer.h"
+
+#define DEBUG_WRITER_SLOTS          16
+#define DEBUG_WRITER_MAX_PIXELS     (128 * 128)
+#define DEBUG_WRITER_PATH_LEN       512
+
+enum slot_state
+{
+    SLOT_FREE,
+    SLOT_FILLING,
+    SLOT_READY,
+    SLOT_WRITING,
+};
+
+struct debug_slot
+{
+    enum slot_state state;
+    char path[DEBUG_WRITER_PATH_LEN];
+    uint32_t w;
+    uint32_t h;
+    uint32_t *pixels;
+};
+
+/*
+ * slots are filled in order at tail and written in the same order from head,
+ * the mutex is held only to move the slots between states, never while
+ * copying or encoding
+ */
+struct debug_writer
+{
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    struct debug_slot slots[DEBUG_WRITER_SLOTS];
+    uint32_t head;
+    uint32_t tail;
+    uint64_t dropped;
+    bool stop;
+};
+
+static void write_slot(struct debug_slot *slot)
+{
+    PIX *pix = pixCreateNoInit(slot->w, slot->h, 32);
+    l_uint32 *data = pixGetData(pix);
+    int wpl = pixGetWpl(pix);
+
+    for (uint32_t y = 0; y < slot->h; y++)
+        memcpy(data + y * wpl, slot->pixels + y * slot->w, slot->w * sizeof(uint32_t));
+
+    pixWrite(slot->path, pix, IFF_PNG);
+
+    pixDestroy(&pix);
+}
+
+static void *debug_writer_thread(void *data)
+{
+    struct debug_writer *writer = data;
+
+    os_set_thread_name("apex-game: debug writer");
+
+    pthread_mutex_lock(&writer->mutex);
+
+    for (;;) {
+        struct debug_slot *slot = &writer->slots[writer->head];
+
+        while (!writer->stop && slot->state != SLOT_READY)
+            pthread_cond_wait(&writer->cond, &writer->mutex);
+
+        if (slot->state != SLOT_READY)
+            break;
+
+        slot->state = SLOT_WRITING;
+
+        pthread_mutex_unlock(&writer->mutex);
+
+        write_slot(slot);
+
+        pthread_mutex_lock(&writer->mutex);
+
+        slot->state = SLOT_FREE;
+        writer->head = (writer->head + 1) % DEBUG_WRITER_SLOTS;
+    }
+
+    pthread_mutex_unlock(&writer->mutex);
+
+    return NULL;
+}
+
+struct debug_writer *debug_writer_create(void)
+{
+    struct debug_writer *writer = bzalloc(sizeof(struct debug_writer));
+
+    for (int i = 0; i < DEBUG_WRITER_SLOTS; i++)
+        writer->slots[i].pixels = bmalloc(DEBUG_WRITER_MAX_PIXELS * sizeof(uint32_t));
+
+    pthread_mutex_init(&writer->mutex, NULL);
+    pthread_cond_init(&writer->cond, NULL);
+
+    if (pthread_create(&writer->thread, NULL, debug_writer_thread, writer) != 0) {
+        writer->stop = true;
+        debug_writer_destroy(writer);
+        return NULL;
+    }
+
+    return writer;
+}
+
+/*
+ * the captures still queued are written before the thread exits
+ */
+void debug_writer_destroy(struct debug_writer *writer)
+{
+    if (!writer)
+        return;
+
+    if (!writer->stop) {
+        pthread_mutex_lock(&writer->mutex);
+        writer->stop = true;
+        pthread_cond_signal(&writer->cond);
+        pthread_mutex_unlock(&writer->mutex);
+
+        pthread_join(writer->thread, NULL);
+    }
+
+    pthread_cond_destroy(&writer->cond);
+    pthread_mutex_destroy(&writer->mutex);
+
+    for (int i = 0; i < DEBUG_WRITER_SLOTS; i++)
+        bfree(writer->slots[i].pixels);
+
+    bfree(writer);
+}
+
+bool debug_writer_push(struct debug_writer *writer, const char *path, PIX *image, uint32_t x, uint32_t y, uint32_t w, uint32_t h)
+{
+    if (!writer || !image)
+        return false;
+
+    pthread_mutex_lock(&writer->mutex);
+
+    struct debug_slot *slot = &writer->slots[writer->tail];
+    bool too_big = (uint64_t)w * h > DEBUG_WRITER_MAX_PIXELS || strlen(path) >= DEBUG_WRITER_PATH_LEN ||
+                   x + w > (uint32_t)pixGetWidth(image) || y + h > (uint32_t)pixGetHeight(image);
+
+    if (slot->state != SLOT_FREE || too_big || writer->stop) {
+        writer->dropped++;
+        pthread_mutex_unlock(&writer->mutex);
+        return false;
+    }
+
+    slot->state = SLOT_FILLING;
+    writer->tail = (writer->tail + 1) % DEBUG_WRITER_SLOTS;
+
+    pthread_mutex_unlock(&writer->mutex);
+
+    const l_uint32 *data = pixGetData(image);
+    int wpl = pixGetWpl(image);
+
+    for (uint32_t row = 0; row < h; row++)
+        memcpy(slot->pixels + row * w, data + (y + row) * wpl + x, w * sizeof(uint32_t));
+
+    strcpy(slot->path, path);
+    slot->w = w;
+    slot->h = h;
+
+    pthread_mutex_lock(&writer->mutex);
+    slot->state = SLOT_READY;
+    pthread_cond_signal(&writer->cond);
+    pthread_mutex_unlock(&writer->mutex);
+
+    return true;
+}
+
+uint64_t debug_writer_dropped(struct debug_writer *writer)
+{
+    if (!writer)
+        return 0;
+
+    pthread_mutex_lock(&writer->mutex);
+    uint64_t dropped = writer->dropped;
+    pthread_mutex_unlock(&writer->mutex);
+
+    return dropped;
+}
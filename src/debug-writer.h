@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <leptonica/allheaders.h>
+
+struct debug_writer;
+
+struct debug_writer *debug_writer_create(void);
+void debug_writer_destroy(struct debug_writer *writer);
+
+/*
+ * copies a rectangle of the image in a free slot of the ring, the PNG is
+ * encoded and written to path by the writer thread. when no slot is free the
+ * capture is dropped, the caller is never blocked by the encoding.
+ */
+bool debug_writer_push(struct debug_writer *writer, const char *path, PIX *image, uint32_t x, uint32_t y, uint32_t w, uint32_t h);
+
+uint64_t debug_writer_dropped(struct debug_writer *writer);
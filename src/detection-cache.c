@@ -0,0 +1,155 @@
+#include <string.h>
+
+#include <util/bmem.h>
+#include <util/threading.h>
+
+#include "detection-cache.h"
+
+struct detection_cache_entry
+{
+    struct detection_cache_entry *next;
+    const void *parent;
+    uint64_t config;
+    uint32_t refs;
+    const void *owner;              /* filter that claimed claimed_ns */
+    uint64_t claimed_ns;
+    uint64_t sequence;              /* of the result, 0 before the first one */
+    size_t result_size;
+    uint8_t result[];
+};
+
+/*
+ * a handful of entries at most, one per parent and configuration: a list
+ * under a single mutex, held only to look up or copy a result
+ */
+struct detection_cache
+{
+    pthread_mutex_t mutex;
+    struct detection_cache_entry *entries;
+};
+
+struct detection_cache *detection_cache_create(void)
+{
+    struct detection_cache *cache = bzalloc(sizeof(struct detection_cache));
+
+    pthread_mutex_init(&cache->mutex, NULL);
+
+    return cache;
+}
+
+void detection_cache_destroy(struct detection_cache *cache)
+{
+    if (!cache)
+        return;
+
+    while (cache->entries) {
+        struct detection_cache_entry *entry = cache->entries;
+
+        cache->entries = entry->next;
+        bfree(entry);
+    }
+
+    pthread_mutex_destroy(&cache->mutex);
+    bfree(cache);
+}
+
+struct detection_cache_entry *detection_cache_acquire(struct detection_cache *cache, const void *parent, uint64_t config, size_t result_size)
+{
+    struct detection_cache_entry *entry;
+
+    pthread_mutex_lock(&cache->mutex);
+
+    for (entry = cache->entries; entry; entry = entry->next)
+        if (entry->parent == parent && entry->config == config && entry->result_size == result_size)
+            break;
+
+    if (!entry) {
+        entry = bzalloc(sizeof(struct detection_cache_entry) + result_size);
+        entry->parent = parent;
+        entry->config = config;
+        entry->result_size = result_size;
+        entry->next = cache->entries;
+        cache->entries = entry;
+    }
+
+    entry->refs++;
+
+    pthread_mutex_unlock(&cache->mutex);
+
+    return entry;
+}
+
+void detection_cache_release(struct detection_cache *cache, struct detection_cache_entry *entry, const void *owner)
+{
+    pthread_mutex_lock(&cache->mutex);
+
+    if (entry->owner == owner)
+        entry->owner = NULL;
+
+    if (--entry->refs) {
+        pthread_mutex_unlock(&cache->mutex);
+        return;
+    }
+
+    for (struct detection_cache_entry **e = &cache->entries; *e; e = &(*e)->next) {
+        if (*e == entry) {
+            *e = entry->next;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&cache->mutex);
+
+    bfree(entry);
+}
+
+/*
+ * the filter that stops claiming (ie. disabled or removed) hands the frames
+ * over to the next one
+ */
+bool detection_cache_claim(struct detection_cache *cache, struct detection_cache_entry *entry, const void *owner, uint64_t frame_ns)
+{
+    bool claimed = true;
+
+    pthread_mutex_lock(&cache->mutex);
+
+    if (entry->owner && entry->owner != owner && entry->claimed_ns == frame_ns) {
+        claimed = false;
+    } else {
+        entry->owner = owner;
+        entry->claimed_ns = frame_ns;
+    }
+
+    pthread_mutex_unlock(&cache->mutex);
+
+    return claimed;
+}
+
+uint64_t detection_cache_publish(struct detection_cache *cache, struct detection_cache_entry *entry, const void *result)
+{
+    pthread_mutex_lock(&cache->mutex);
+
+    memcpy(entry->result, result, entry->result_size);
+    uint64_t sequence = ++entry->sequence;
+
+    pthread_mutex_unlock(&cache->mutex);
+
+    return sequence;
+}
+
+bool detection_cache_fetch(struct detection_cache *cache, struct detection_cache_entry *entry, void *result, uint64_t *sequence)
+{
+    bool fetched = false;
+
+    pthread_mutex_lock(&cache->mutex);
+
+    if (entry->sequence != *sequence) {
+        memcpy(result, entry->result, entry->result_size);
+        *sequence = entry->sequence;
+        fetched = true;
+    }
+
+    pthread_mutex_unlock(&cache->mutex);
+
+    return fetched;
+}
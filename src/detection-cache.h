@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * detection results shared by the filters that watch the same parent source
+ * with the same configuration (ie. one game capture shown in several scenes,
+ * each with its own filter): the first filter that claims a frame renders and
+ * matches it and publishes its result, the others take the result instead of
+ * reading back and matching the same pixels.
+ *
+ * an entry is keyed by the parent and by a hash of the settings that decide
+ * the result. the result is an opaque block of result_size bytes numbered by
+ * the publications of the entry: the frame times of async sources go back
+ * when the source restarts or loops, they only tell the frames apart. the
+ * parent is only compared, never dereferenced.
+ */
+
+struct detection_cache;
+struct detection_cache_entry;
+
+struct detection_cache *detection_cache_create(void);
+void detection_cache_destroy(struct detection_cache *cache);
+
+/*
+ * the entry is shared by every filter that acquired it until they all
+ * released it, owner is the filter that releases it
+ */
+struct detection_cache_entry *detection_cache_acquire(struct detection_cache *cache, const void *parent, uint64_t config, size_t result_size);
+void detection_cache_release(struct detection_cache *cache, struct detection_cache_entry *entry, const void *owner);
+
+/*
+ * true when owner is the first to claim the frame: it detects the frame and
+ * publishes the result. a frame claimed by another filter returns false.
+ */
+bool detection_cache_claim(struct detection_cache *cache, struct detection_cache_entry *entry, const void *owner, uint64_t frame_ns);
+
+/*
+ * returns the sequence number of the result, the owner is unique per claim
+ */
+uint64_t detection_cache_publish(struct detection_cache *cache, struct detection_cache_entry *entry, const void *result);
+
+/*
+ * copies the result when it was published after the one numbered sequence
+ * (0 before the first one) and updates sequence
+ */
+bool detection_cache_fetch(struct detection_cache *cache, struct detection_cache_entry *entry, void *result, uint64_t *sequence);
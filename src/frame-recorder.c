@@ -0,0 +1,240 @@
+#include <obs-module.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#include "frame-recorder.h"
+#include "lz4-block.h"
+
+#define RECORDER_SLOTS      8
+
+enum slot_state
+{
+    SLOT_FREE,
+    SLOT_READY,
+    SLOT_WRITING,
+};
+
+struct record_slot
+{
+    enum slot_state state;
+    struct recording_record record;
+    uint8_t *payload;
+    size_t capacity;
+};
+
+/*
+ * like the debug writer the slots are filled at tail and written from head.
+ * the buffers of the slots grow to the size of the largest record and are
+ * then reused, compression happens on the writer thread.
+ */
+struct frame_recorder
+{
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    struct record_slot slots[RECORDER_SLOTS];
+    uint32_t head;
+    uint32_t tail;
+    uint64_t dropped;
+    FILE *file;
+    bool compress;
+    bool active;
+    bool stop;
+    uint8_t *compressed;
+    size_t compressed_capacity;
+};
+
+static void write_record(struct frame_recorder *recorder, struct record_slot *slot)
+{
+    struct recording_record *record = &slot->record;
+    const uint8_t *payload = slot->payload;
+
+    record->size = record->raw_size;
+    record->flags &= ~RECORD_COMPRESSED;
+
+    if (recorder->compress && record->raw_size) {
+        size_t bound = lz4_compress_bound(record->raw_size);
+
+        if (bound > recorder->compressed_capacity) {
+            recorder->compressed = brealloc(recorder->compressed, bound);
+            recorder->compressed_capacity = bound;
+        }
+
+        size_t size = lz4_compress(slot->payload, record->raw_size, recorder->compressed);
+
+        if (size < record->raw_size) {
+            record->size = (uint32_t)size;
+            record->flags |= RECORD_COMPRESSED;
+            payload = recorder->compressed;
+        }
+    }
+
+    fwrite(record, sizeof(struct recording_record), 1, recorder->file);
+    fwrite(payload, 1, record->size, recorder->file);
+}
+
+static void *frame_recorder_thread(void *data)
+{
+    struct frame_recorder *recorder = data;
+
+    os_set_thread_name("apex-game: recorder");
+
+    pthread_mutex_lock(&recorder->mutex);
+
+    for (;;) {
+        struct record_slot *slot = &recorder->slots[recorder->head];
+
+        while (!recorder->stop && slot->state != SLOT_READY)
+            pthread_cond_wait(&recorder->cond, &recorder->mutex);
+
+        if (slot->state != SLOT_READY)
+            break;
+
+        slot->state = SLOT_WRITING;
+
+        pthread_mutex_unlock(&recorder->mutex);
+
+        write_record(recorder, slot);
+
+        pthread_mutex_lock(&recorder->mutex);
+
+        slot->state = SLOT_FREE;
+        recorder->head = (recorder->head + 1) % RECORDER_SLOTS;
+    }
+
+    pthread_mutex_unlock(&recorder->mutex);
+
+    return NULL;
+}
+
+struct frame_recorder *frame_recorder_create(void)
+{
+    struct frame_recorder *recorder = bzalloc(sizeof(struct frame_recorder));
+
+    pthread_mutex_init(&recorder->mutex, NULL);
+    pthread_cond_init(&recorder->cond, NULL);
+
+    return recorder;
+}
+
+void frame_recorder_destroy(struct frame_recorder *recorder)
+{
+    if (!recorder)
+        return;
+
+    frame_recorder_stop(recorder);
+
+    pthread_cond_destroy(&recorder->cond);
+    pthread_mutex_destroy(&recorder->mutex);
+
+    for (int i = 0; i < RECORDER_SLOTS; i++)
+        bfree(recorder->slots[i].payload);
+
+    bfree(recorder->compressed);
+    bfree(recorder);
+}
+
+bool frame_recorder_start(struct frame_recorder *recorder, const char *path, bool compress)
+{
+    frame_recorder_stop(recorder);
+
+    FILE *file = os_fopen(path, "wbx");
+
+    if (!file)
+        return false;
+
+    struct recording_header header =
+    {
+        .magic = RECORDING_MAGIC,
+        .version = RECORDING_VERSION,
+        .start_ns = os_gettime_ns(),
+    };
+
+    fwrite(&header, sizeof(header), 1, file);
+
+    recorder->file = file;
+    recorder->compress = compress;
+    recorder->stop = false;
+
+    if (pthread_create(&recorder->thread, NULL, frame_recorder_thread, recorder) != 0) {
+        fclose(file);
+        recorder->file = NULL;
+        return false;
+    }
+
+    pthread_mutex_lock(&recorder->mutex);
+    recorder->active = true;
+    pthread_mutex_unlock(&recorder->mutex);
+
+    return true;
+}
+
+void frame_recorder_stop(struct frame_recorder *recorder)
+{
+    pthread_mutex_lock(&recorder->mutex);
+
+    bool active = recorder->active;
+
+    recorder->active = false;
+    recorder->stop = true;
+    pthread_cond_signal(&recorder->cond);
+
+    pthread_mutex_unlock(&recorder->mutex);
+
+    if (!active)
+        return;
+
+    pthread_join(recorder->thread, NULL);
+
+    fclose(recorder->file);
+    recorder->file = NULL;
+}
+
+/*
+ * the mutex stays locked until commit: the payload is copied while the
+ * writer can only be busy on another slot
+ */
+uint8_t *frame_recorder_begin(struct frame_recorder *recorder, const struct recording_record *record, size_t payload_size)
+{
+    pthread_mutex_lock(&recorder->mutex);
+
+    struct record_slot *slot = &recorder->slots[recorder->tail];
+
+    if (!recorder->active || slot->state != SLOT_FREE || payload_size > UINT32_MAX) {
+        if (recorder->active)
+            recorder->dropped++;
+
+        pthread_mutex_unlock(&recorder->mutex);
+        return NULL;
+    }
+
+    if (payload_size > slot->capacity) {
+        slot->payload = brealloc(slot->payload, payload_size);
+        slot->capacity = payload_size;
+    }
+
+    slot->record = *record;
+    slot->record.raw_size = (uint32_t)payload_size;
+
+    return slot->payload;
+}
+
+void frame_recorder_commit(struct frame_recorder *recorder)
+{
+    recorder->slots[recorder->tail].state = SLOT_READY;
+    recorder->tail = (recorder->tail + 1) % RECORDER_SLOTS;
+
+    pthread_cond_signal(&recorder->cond);
+    pthread_mutex_unlock(&recorder->mutex);
+}
+
+uint64_t frame_recorder_dropped(struct frame_recorder *recorder)
+{
+    pthread_mutex_lock(&recorder->mutex);
+    uint64_t dropped = recorder->dropped;
+    pthread_mutex_unlock(&recorder->mutex);
+
+    return dropped;
+}
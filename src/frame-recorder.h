@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frame-recording.h"
+
+struct frame_recorder;
+
+struct frame_recorder *frame_recorder_create(void);
+void frame_recorder_destroy(struct frame_recorder *recorder);
+
+/*
+ * a recording is written by its own thread, stopping it writes the records
+ * still queued and closes the file. the file is created, start fails when it
+ * already exists.
+ */
+bool frame_recorder_start(struct frame_recorder *recorder, const char *path, bool compress);
+void frame_recorder_stop(struct frame_recorder *recorder);
+
+/*
+ * begin returns the buffer where the payload of the record is copied, or NULL
+ * when the record is dropped because the writer is behind. a successful begin
+ * must be followed by commit.
+ */
+uint8_t *frame_recorder_begin(struct frame_recorder *recorder, const struct recording_record *record, size_t payload_size);
+void frame_recorder_commit(struct frame_recorder *recorder);
+
+uint64_t frame_recorder_dropped(struct frame_recorder *recorder);
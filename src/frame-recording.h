@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * a recording is an append-only little-endian file: a header followed by one
+ * record per recorded frame, each made of struct recording_record and its
+ * payload. a record whose payload is compressed uses the LZ4 block format,
+ * raw_size is the size once decompressed.
+ *
+ * areas records: the payload is a sequence of struct recording_area, each
+ * followed by w * h leptonica 32 bpp words of the rectangle (frame
+ * coordinates, the match offsets are already applied).
+ *
+ * full frame records: the payload holds the planes of the frame without
+ * padding: RGBA/BGRA 4 bytes per pixel, NV12 luma + interleaved chroma at half
+ * resolution, I420 luma + U + V at half resolution. yuv_matrix is the 16.16
+ * fixed point conversion matrix of YUV frames.
+ */
+
+#define RECORDING_MAGIC         0x52585041 /* "APXR" */
+#define RECORDING_VERSION       1
+#define RECORDING_EXTENSION     "apxr"
+
+#define RECORD_FULL_FRAME       (1 << 0)
+#define RECORD_COMPRESSED       (1 << 1)
+
+enum recording_format
+{
+    RECORDING_FORMAT_RGBA,
+    RECORDING_FORMAT_BGRA,
+    RECORDING_FORMAT_NV12,
+    RECORDING_FORMAT_I420,
+};
+
+struct recording_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t start_ns;
+};
+
+struct recording_record
+{
+    uint32_t size;
+    uint32_t raw_size;
+    uint32_t flags;
+    uint32_t frame;
+    uint64_t timestamp_ns;
+    uint16_t width;
+    uint16_t height;
+    uint8_t format;
+    uint8_t display;
+    uint8_t language;
+    uint8_t input;
+    uint8_t character;
+    uint8_t spectate_color;
+    uint8_t banners;
+    uint8_t areas;
+    int32_t yuv_matrix[3][4];
+};
+
+struct recording_area
+{
+    uint32_t area;
+    uint32_t x;
+    uint32_t y;
+    uint32_t w;
+    uint32_t h;
+};
@@ -0,0 +1,133 @@
+#include <string.h>
+
+#include "glyph-mask.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define popcount64(x)   ((uint32_t)__popcnt64(x))
+#else
+#define popcount64(x)   ((uint32_t)__builtin_popcountll(x))
+#endif
+
+static uint32_t pixel_luma(uint32_t pixel)
+{
+    uint32_t r = pixel >> 24, g = (pixel >> 16) & 0xff, b = (pixel >> 8) & 0xff;
+
+    return (77 * r + 150 * g + 29 * b) >> 8;
+}
+
+static bool glyph_pixel(const struct glyph_mask *mask, uint32_t pixel)
+{
+    uint32_t r = pixel >> 24, g = (pixel >> 16) & 0xff, b = (pixel >> 8) & 0xff;
+
+    return r >= mask->low[0] && r <= mask->high[0] && g >= mask->low[1] && g <= mask->high[1] && b >= mask->low[2] &&
+           b <= mask->high[2];
+}
+
+static uint8_t widen(int32_t value, int32_t slack)
+{
+    value += slack;
+
+    return value < 0 ? 0 : value > 255 ? 255 : (uint8_t)value;
+}
+
+bool glyph_mask_build(struct glyph_mask *mask, const uint32_t *pixels, uint32_t wpl, uint32_t w, uint32_t h, uint32_t color_slack)
+{
+    uint32_t min_luma = 255, max_luma = 0;
+    uint32_t low[3] = { 255, 255, 255 }, high[3] = { 0, 0, 0 };
+
+    memset(mask, 0, sizeof(*mask));
+
+    if (!w || !h || (uint64_t)w * h > GLYPH_MASK_PIXELS)
+        return false;
+
+    for (uint32_t y = 0; y < h; y++) {
+        for (uint32_t x = 0; x < w; x++) {
+            uint32_t luma = pixel_luma(pixels[y * wpl + x]);
+
+            if (luma < min_luma)
+                min_luma = luma;
+
+            if (luma > max_luma)
+                max_luma = luma;
+        }
+    }
+
+    if (max_luma - min_luma < GLYPH_MASK_MIN_CONTRAST)
+        return false;
+
+    uint32_t middle = (min_luma + max_luma + 1) / 2;
+    uint32_t bright = 0, i = 0;
+
+    for (uint32_t y = 0; y < h; y++)
+        for (uint32_t x = 0; x < w; x++)
+            bright += pixel_luma(pixels[y * wpl + x]) >= middle;
+
+    /* the glyph is the smaller side of the split */
+    bool glyph_bright = 2 * bright <= w * h;
+
+    for (uint32_t y = 0; y < h; y++) {
+        for (uint32_t x = 0; x < w; x++, i++) {
+            uint32_t pixel = pixels[y * wpl + x];
+            uint32_t channels[3] = { pixel >> 24, (pixel >> 16) & 0xff, (pixel >> 8) & 0xff };
+
+            if ((pixel_luma(pixel) >= middle) != glyph_bright)
+                continue;
+
+            mask->bits[i / 64] |= 1ULL << (i % 64);
+            mask->glyph++;
+
+            for (int c = 0; c < 3; c++) {
+                if (channels[c] < low[c])
+                    low[c] = channels[c];
+
+                if (channels[c] > high[c])
+                    high[c] = channels[c];
+            }
+        }
+    }
+
+    for (int c = 0; c < 3; c++) {
+        mask->low[c] = widen((int32_t)low[c], -(int32_t)color_slack);
+        mask->high[c] = widen((int32_t)high[c], (int32_t)color_slack);
+    }
+
+    mask->w = w;
+    mask->h = h;
+    mask->background = w * h - mask->glyph;
+
+    return true;
+}
+
+void glyph_mask_match(const struct glyph_mask *mask, const uint32_t *pixels, uint32_t wpl, struct glyph_match *match)
+{
+    const uint64_t *bits = mask->bits;
+    uint32_t filled = 0;
+    uint64_t word = 0;
+
+    match->missed = 0;
+    match->stray = 0;
+
+    for (uint32_t y = 0; y < mask->h; y++) {
+        const uint32_t *line = pixels + (size_t)y * wpl;
+
+        for (uint32_t x = 0; x < mask->w; x++) {
+            word |= (uint64_t)glyph_pixel(mask, line[x]) << filled;
+
+            if (++filled < 64)
+                continue;
+
+            match->missed += popcount64(*bits & ~word);
+            match->stray += popcount64(word & ~*bits);
+            bits++;
+            word = 0;
+            filled = 0;
+        }
+    }
+
+    /* the bits of the last word past the area are clear on both sides */
+    if (filled) {
+        match->missed += popcount64(*bits & ~word);
+        match->stray += popcount64(word & ~*bits);
+    }
+}
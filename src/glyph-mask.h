@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * 1-bit templates of the key hints (ie. the M of the map button): only the
+ * pixels of the glyph matter, the background behind the hint changes with the
+ * game.
+ *
+ * the luma range of a reference is split in the middle and the glyph is the
+ * smaller side: the dark letter on a bright key cap, the bright symbol of a
+ * pad button on the scene. the colour bounds of the glyph pixels widened by a
+ * slack make the colour of the glyph. an area is thresholded with the bounds
+ * of the template while it is read, 64 pixels per word, and compared with
+ * popcount over the words: glyph pixels missing from the area and pixels of
+ * the colour of the glyph out of it. the bits follow the pixels row after row
+ * without padding.
+ *
+ * pixels are leptonica 32 bpp words (r << 24 | g << 16 | b << 8).
+ */
+
+#define GLYPH_MASK_WORDS        128
+#define GLYPH_MASK_PIXELS       (GLYPH_MASK_WORDS * 64)
+
+/* luma range of a reference below which it has no glyph */
+#define GLYPH_MASK_MIN_CONTRAST 32
+
+struct glyph_mask
+{
+    uint32_t w;                         /* 0 when the reference has no mask */
+    uint32_t h;
+    uint32_t glyph;                     /* pixels set in the mask */
+    uint32_t background;                /* pixels clear in the mask */
+    uint8_t low[3];                     /* colour bounds of the glyph, r g b */
+    uint8_t high[3];
+    uint64_t bits[GLYPH_MASK_WORDS];
+};
+
+/*
+ * false when the reference is too large or has no glyph, the mask is left
+ * empty
+ */
+bool glyph_mask_build(struct glyph_mask *mask, const uint32_t *pixels, uint32_t wpl, uint32_t w, uint32_t h, uint32_t color_slack);
+
+struct glyph_match
+{
+    uint32_t missed;                    /* glyph pixels not of its colour */
+    uint32_t stray;                     /* background pixels of its colour */
+};
+
+/*
+ * pixels points at the top left corner of an area of the size of the mask
+ */
+void glyph_mask_match(const struct glyph_mask *mask, const uint32_t *pixels, uint32_t wpl, struct glyph_match *match);
+
+/*
+ * the worse of the share of the glyph found and of the share of the
+ * background clear of the colour of the glyph: a flat area, whatever its
+ * colour, fails one of the two and scores 0
+ */
+static inline float glyph_mask_score(const struct glyph_mask *mask, const struct glyph_match *match)
+{
+    if (!mask->glyph || !mask->background)
+        return 0.0f;
+
+    float found = 1.0f - (float)match->missed / mask->glyph;
+    float clear = 1.0f - (float)match->stray / mask->background;
+
+    return found < clear ? found : clear;
+}
@@ -0,0 +1,135 @@
+#include <obs-module.h>
+
+#include <util/bmem.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "hud-export.h"
+
+#define export_warn(name, format, ...) blog(LOG_WARNING, "[apex-game] shared memory %s: " format, name, ##__VA_ARGS__)
+
+#define SEGMENT_NAME_LEN    128
+
+struct hud_export
+{
+    struct hud_export_segment *segment;
+    char name[SEGMENT_NAME_LEN];
+    bool created;
+    bool published;
+#ifdef _WIN32
+    HANDLE mapping;
+#endif
+};
+
+struct hud_export *hud_export_create(const char *name)
+{
+    struct hud_export *export = bzalloc(sizeof(struct hud_export));
+    void *data = NULL;
+
+    hud_export_segment_name(export->name, sizeof(export->name), name);
+
+#ifdef _WIN32
+    wchar_t *wname = NULL;
+
+    if (os_utf8_to_wcs_ptr(export->name, 0, &wname)) {
+        export->mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(struct hud_export_segment), wname);
+        bfree(wname);
+    }
+
+    /* the mapping of another writer, or of a reader, is opened instead */
+    if (export->mapping && GetLastError() == ERROR_ALREADY_EXISTS) {
+        export_warn(export->name, "the name is already in use");
+        hud_export_destroy(export);
+        return NULL;
+    }
+
+    export->created = export->mapping != NULL;
+
+    if (export->mapping)
+        data = MapViewOfFile(export->mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(struct hud_export_segment));
+#else
+    int fd = shm_open(export->name, O_CREAT | O_EXCL | O_RDWR, 0644);
+
+    /* a segment left by a crash has to be removed by hand, ie. from /dev/shm */
+    if (fd < 0 && errno == EEXIST) {
+        export_warn(export->name, "the name is already in use");
+        hud_export_destroy(export);
+        return NULL;
+    }
+
+    if (fd >= 0) {
+        export->created = true;
+
+        if (ftruncate(fd, sizeof(struct hud_export_segment)) == 0) {
+            data = mmap(NULL, sizeof(struct hud_export_segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+            if (data == MAP_FAILED)
+                data = NULL;
+        }
+
+        close(fd);
+    }
+#endif
+
+    if (!data) {
+        export_warn(export->name, "unable to create the segment");
+        hud_export_destroy(export);
+        return NULL;
+    }
+
+    export->segment = data;
+
+    /* an odd sequence keeps the readers away until the first publication */
+    export->segment->sequence |= 1;
+    export->segment->magic = HUD_EXPORT_MAGIC;
+    export->segment->version = HUD_EXPORT_VERSION;
+    export->segment->size = sizeof(struct hud_export_segment);
+
+    return export;
+}
+
+void hud_export_destroy(struct hud_export *export)
+{
+    if (!export)
+        return;
+
+#ifdef _WIN32
+    if (export->segment)
+        UnmapViewOfFile(export->segment);
+
+    if (export->mapping)
+        CloseHandle(export->mapping);
+#else
+    if (export->segment)
+        munmap(export->segment, sizeof(struct hud_export_segment));
+
+    /* readers that still have the segment mapped keep their copy */
+    if (export->created)
+        shm_unlink(export->name);
+#endif
+
+    bfree(export);
+}
+
+void hud_export_publish(struct hud_export *export, const struct hud_export_state *state)
+{
+    if (export->published) {
+        hud_export_write(export->segment, state);
+        return;
+    }
+
+    /* the sequence is still odd from create */
+    memcpy(&export->segment->state, state, sizeof(*state));
+    hud_export_release();
+    export->segment->sequence++;
+
+    export->published = true;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/*
+ * shared memory segment where a filter publishes its latest detection result
+ * for processes running outside OBS. this header is also used by the readers
+ * and does not depend on libobs.
+ *
+ * the state is protected by a seqlock: the writer makes the sequence odd,
+ * updates the state and makes it even again, a reader copies the state and
+ * retries when the sequence was odd or changed in the meantime. neither side
+ * ever waits for the other.
+ */
+
+#define HUD_EXPORT_MAGIC        0x53585041 /* "APXS" */
+#define HUD_EXPORT_VERSION      2
+#define HUD_EXPORT_PREFIX       "apex-game-"
+
+#define HUD_EXPORT_BANNERS      5
+#define HUD_EXPORT_COUNTERS     2
+#define HUD_EXPORT_NAME_LEN     16
+
+struct hud_export_state
+{
+    uint64_t frame;                 /* incremented on every analysed frame */
+    uint64_t timestamp_ns;          /* monotonic clock when published */
+    uint64_t frame_timestamp_ns;    /* timestamp of the analysed frame */
+    uint32_t banners;               /* bit mask of game, looting, inventory, map, spectate */
+    uint32_t character;
+    uint32_t spectate_color;
+    uint32_t display;
+    uint32_t language;
+    uint32_t input;
+    float confidence[HUD_EXPORT_BANNERS];
+    char hud[HUD_EXPORT_NAME_LEN];
+    char character_name[HUD_EXPORT_NAME_LEN];
+    char spectate_color_name[HUD_EXPORT_NAME_LEN];
+    uint32_t counter_changes[HUD_EXPORT_COUNTERS];      /* changes of squads left and kills */
+};
+
+struct hud_export_segment
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint32_t sequence;
+    struct hud_export_state state;
+};
+
+/*
+ * MSVC has no C11 fences: ARM64 needs a barrier instruction, loads only for
+ * the acquire side. x86 and x86-64 keep the order of loads and of stores,
+ * there a compiler barrier is enough.
+ */
+#if defined(_MSC_VER) && defined(_M_ARM64)
+#define hud_export_acquire()    __dmb(_ARM64_BARRIER_ISHLD)
+#define hud_export_release()    __dmb(_ARM64_BARRIER_ISH)
+#elif defined(_MSC_VER)
+#define hud_export_acquire()    _ReadWriteBarrier()
+#define hud_export_release()    _ReadWriteBarrier()
+#else
+#define hud_export_acquire()    __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define hud_export_release()    __atomic_thread_fence(__ATOMIC_RELEASE)
+#endif
+
+static inline void hud_export_write(struct hud_export_segment *segment, const struct hud_export_state *state)
+{
+    volatile uint32_t *sequence = &segment->sequence;
+
+    *sequence = *sequence + 1;
+    hud_export_release();
+
+    memcpy(&segment->state, state, sizeof(*state));
+
+    hud_export_release();
+    *sequence = *sequence + 1;
+}
+
+static inline bool hud_export_try_read(const struct hud_export_segment *segment, struct hud_export_state *state)
+{
+    const volatile uint32_t *sequence = &segment->sequence;
+    uint32_t begin = *sequence;
+
+    if (begin & 1)
+        return false;
+
+    hud_export_acquire();
+
+    memcpy(state, &segment->state, sizeof(*state));
+
+    hud_export_acquire();
+
+    return *sequence == begin;
+}
+
+/*
+ * the name given in the filter settings is restricted to a portable subset,
+ * the result is a POSIX shared memory name or a Windows object name
+ */
+#ifdef _WIN32
+#define HUD_EXPORT_SEGMENT_PREFIX   "Local\\" HUD_EXPORT_PREFIX
+#else
+#define HUD_EXPORT_SEGMENT_PREFIX   "/" HUD_EXPORT_PREFIX
+#endif
+
+static inline void hud_export_segment_name(char *dst, size_t size, const char *name)
+{
+    size_t prefix = strlen(HUD_EXPORT_SEGMENT_PREFIX);
+
+    snprintf(dst, size, "%s%s", HUD_EXPORT_SEGMENT_PREFIX, name);
+
+    if (prefix >= size)
+        return;
+
+    for (char *c = dst + prefix; *c; c++) {
+        if (!((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') || *c == '-' || *c == '_'))
+            *c = '_';
+    }
+}
+
+/*
+ * writer side, implemented in the plugin. a name already in use (ie. by
+ * another filter) is refused, the segment is removed when the writer that
+ * created it is destroyed.
+ */
+struct hud_export;
+
+struct hud_export *hud_export_create(const char *name);
+void hud_export_destroy(struct hud_export *export);
+void hud_export_publish(struct hud_export *export, const struct hud_export_state *state);
@@ -0,0 +1,93 @@
+#include "hud-tables.h"
+
+const char *character_name_str[CHARACTERS_NUM] =
+{
+    "bloodhound",
+    "gibraltar",
+    "lifeline",
+    "pathfinder",
+    "wraith",
+    "bangalore",
+    "caustic",
+    "mirage",
+    "octane",
+    "wattson",
+    "crypto",
+    "revenant",
+    "loba",
+    "rampart",
+    "horizon",
+    "fuse",
+    "valkyrie",
+    "seer",
+    "ash",
+    "madmaggie",
+    "newcastle",
+    "vantage",
+    "catalyst",
+    "ballistic",
+};
+
+const char *banner_position_str[BANNER_POSITION_NUM] =
+{
+    "game",
+    "looting",
+    "inventory",
+    "map",
+    "spectate",
+};
+
+const char *area_name_str[AREAS_NUM] =
+{
+    "MAP_GAME_BUTTON",
+    "GRENADE_GAME_BUTTON",
+    "ESC_LOOTING_BUTTON",
+    "ESC_INVENTORY_BUTTON",
+    "GRAYBAR_INVENTORY_BUTTON",
+    "M_MAP_BUTTON",
+    "PG_BANNER_IMAGE",
+    "PAD_MAP_BUTTON",
+    "PAD_LOOTING_BUTTON",
+    "PAD_INVENTORY_BUTTON",
+    "PAD_TACTICAL_BUTTON",
+    "SPECTATE_IMAGE_RED",
+    "SPECTATE_IMAGE_GREEN",
+    "SPECTATE_IMAGE_ORANGE",
+    "SPECTATE_IMAGE_BLUE",
+    "SQUADS_LEFT_IMAGE",
+    "KILL_COUNT_IMAGE",
+};
+
+const char *match_metric_str[METRICS_NUM] =
+{
+    "psnr",
+    "ncc",
+    "glyph",
+};
+
+const char *spectate_color_str[SPECTATE_COLORS_NUM] =
+{
+    "red",
+    "green",
+    "orange",
+    "blue",
+};
+
+const char *game_language_str[LANGUAGES] =
+{
+    "it",
+    "en",
+    "zh",
+};
+
+const char *input_device_str[INPUT_DEVICES_NUM] =
+{
+    "mouse",
+    "pad",
+};
+
+const uint32_t display_sizes[DISPLAY_RESOLUTIONS][2] =
+{
+    [DISPLAY_1080P] =   { 1920, 1080 },
+    [DISPLAY_2K] =      { 2560, 1440 },
+};
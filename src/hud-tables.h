@@ -0,0 +1,141 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * the names the plugin, its layout packs, its recordings and the tools agree
+ * on: the order of the enums is the one of the tables of the packs and of the
+ * fields of the records. this header does not depend on libobs.
+ */
+
+#define NCC_MASK_MIN_LUMA           8
+#define GLYPH_COLOR_SLACK           32
+
+enum character_name
+{
+    BLOODHOUND,
+    GIBRALTAR,
+    LIFELINE,
+    PATHFINDER,
+    WRAITH,
+    BANGALORE,
+    CAUSTIC,
+    MIRAGE,
+    OCTANE,
+    WATTSON,
+    CRYPTO,
+    REVENANT,
+    LOBA,
+    RAMPART,
+    HORIZON,
+    FUSE,
+    VALKYRIE,
+    SEER,
+    ASH,
+    MADMAGGIE,
+    NEWCASTLE,
+    VANTAGE,
+    CATALYST,
+    BALLISTIC,
+
+    CHARACTERS_NUM
+};
+typedef enum character_name character_name_t;
+
+extern const char *character_name_str[CHARACTERS_NUM];
+
+enum banner_position
+{
+    BANNER_GAME,
+    BANNER_LOOTING,
+    BANNER_INVENTORY,
+    BANNER_MAP,
+    BANNER_SPECTATE,
+
+    BANNER_POSITION_NUM
+};
+typedef enum banner_position banner_position_t;
+
+extern const char *banner_position_str[BANNER_POSITION_NUM];
+
+enum area_name
+{
+    MAP_GAME_BUTTON,
+    GRENADE_GAME_BUTTON,
+    ESC_LOOTING_BUTTON,
+    ESC_INVENTORY_BUTTON,
+    GRAYBAR_INVENTORY_BUTTON,
+    M_MAP_BUTTON,
+    PG_BANNER_IMAGE,
+    PAD_MAP_BUTTON,
+    PAD_LOOTING_BUTTON,
+    PAD_INVENTORY_BUTTON,
+    PAD_TACTICAL_BUTTON,
+    SPECTATE_IMAGE_RED,
+    SPECTATE_IMAGE_GREEN,
+    SPECTATE_IMAGE_ORANGE,
+    SPECTATE_IMAGE_BLUE,
+    SQUADS_LEFT_IMAGE,
+    KILL_COUNT_IMAGE,
+
+    AREAS_NUM
+};
+typedef enum area_name area_name_t;
+
+extern const char *area_name_str[AREAS_NUM];
+
+enum match_metric
+{
+    METRIC_PSNR,
+    METRIC_LUMA_NCC,
+    METRIC_GLYPH_MASK,
+
+    METRICS_NUM
+};
+typedef enum match_metric match_metric_t;
+
+extern const char *match_metric_str[METRICS_NUM];
+
+enum spectate_color
+{
+    SPECTATE_RED,
+    SPECTATE_GREEN,
+    SPECTATE_ORANGE,
+    SPECTATE_BLUE,
+
+    SPECTATE_COLORS_NUM
+};
+typedef enum spectate_color spectate_color_t;
+
+extern const char *spectate_color_str[SPECTATE_COLORS_NUM];
+
+enum input_device
+{
+    MOUSE_AND_KEYBOARD,
+    PLAY_STATION_PAD,
+
+    INPUT_DEVICES_NUM
+};
+
+extern const char *input_device_str[INPUT_DEVICES_NUM];
+
+enum display_resolution
+{
+    DISPLAY_1080P,
+    DISPLAY_2K,
+
+    DISPLAY_RESOLUTIONS
+};
+
+enum game_language
+{
+    LANGUAGE_IT,
+    LANGUAGE_EN,
+    LANGUAGE_ZH,
+
+    LANGUAGES
+};
+
+extern const char *game_language_str[LANGUAGES];
+
+extern const uint32_t display_sizes[DISPLAY_RESOLUTIONS][2];
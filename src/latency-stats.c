@@ -0,0 +1,160 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "latency-stats.h"
+
+static const char *latency_stage_str[LATENCY_STAGES_NUM] =
+{
+    "readback",
+    "match",
+    "apply",
+    "total",
+};
+
+static const char *latency_set_str[LATENCY_SETS_NUM] =
+{
+    "frames",
+    "transitions",
+};
+
+void latency_stats_init(struct latency_stats *stats)
+{
+    memset(stats->sets, 0, sizeof(stats->sets));
+    pthread_mutex_init(&stats->mutex, NULL);
+}
+
+void latency_stats_free(struct latency_stats *stats)
+{
+    pthread_mutex_destroy(&stats->mutex);
+}
+
+void latency_stats_reset(struct latency_stats *stats)
+{
+    pthread_mutex_lock(&stats->mutex);
+    memset(stats->sets, 0, sizeof(stats->sets));
+    pthread_mutex_unlock(&stats->mutex);
+}
+
+static int us_bucket(uint64_t ns)
+{
+    uint64_t us = ns / 1000;
+    int bucket = 0;
+
+    while (us && bucket < LATENCY_US_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+static void add_sample(struct latency_histogram *h, const uint64_t stages[LATENCY_STAGES_NUM], uint32_t frames)
+{
+    h->count++;
+
+    for (int stage = 0; stage < LATENCY_STAGES_NUM; stage++) {
+        h->sum_ns[stage] += stages[stage];
+        h->us[stage][us_bucket(stages[stage])]++;
+
+        if (stages[stage] > h->max_ns[stage])
+            h->max_ns[stage] = stages[stage];
+    }
+
+    h->frames[frames < LATENCY_FRAME_BUCKETS - 1 ? frames : LATENCY_FRAME_BUCKETS - 1]++;
+}
+
+static uint64_t elapsed(uint64_t from, uint64_t to)
+{
+    return to > from ? to - from : 0;
+}
+
+void latency_stats_add(struct latency_stats *stats, const struct latency_sample *sample, bool transition, uint64_t frame_interval_ns)
+{
+    uint64_t stages[LATENCY_STAGES_NUM] =
+    {
+        [LATENCY_READBACK] =    elapsed(sample->capture_ns, sample->readback_ns),
+        [LATENCY_MATCH] =       elapsed(sample->readback_ns, sample->matched_ns),
+        [LATENCY_APPLY] =       elapsed(sample->matched_ns, sample->applied_ns),
+        [LATENCY_TOTAL] =       elapsed(sample->capture_ns, sample->applied_ns),
+    };
+
+    /* video frame times are multiples of the interval, rounding absorbs the jitter */
+    uint64_t frame_delay = elapsed(sample->capture_frame_ns, sample->applied_frame_ns);
+    uint32_t frames = frame_interval_ns ? (uint32_t)((frame_delay + frame_interval_ns / 2) / frame_interval_ns) : 0;
+
+    pthread_mutex_lock(&stats->mutex);
+
+    add_sample(&stats->sets[LATENCY_FRAMES], stages, frames);
+
+    if (transition)
+        add_sample(&stats->sets[LATENCY_TRANSITIONS], stages, frames);
+
+    pthread_mutex_unlock(&stats->mutex);
+}
+
+void latency_stats_get(struct latency_stats *stats, enum latency_set set, struct latency_histogram *histogram)
+{
+    pthread_mutex_lock(&stats->mutex);
+    *histogram = stats->sets[set];
+    pthread_mutex_unlock(&stats->mutex);
+}
+
+static void append(char *buffer, size_t size, size_t *len, const char *format, ...)
+{
+    va_list args;
+
+    if (*len >= size)
+        return;
+
+    va_start(args, format);
+    int written = vsnprintf(buffer + *len, size - *len, format, args);
+    va_end(args);
+
+    if (written > 0)
+        *len += (size_t)written;
+}
+
+void latency_stats_format(struct latency_stats *stats, char *buffer, size_t size)
+{
+    struct latency_histogram sets[LATENCY_SETS_NUM];
+    size_t len = 0;
+
+    if (!size)
+        return;
+
+    buffer[0] = '\0';
+
+    pthread_mutex_lock(&stats->mutex);
+    memcpy(sets, stats->sets, sizeof(sets));
+    pthread_mutex_unlock(&stats->mutex);
+
+    append(buffer, size, &len, "{");
+
+    for (int set = 0; set < LATENCY_SETS_NUM; set++) {
+        const struct latency_histogram *h = &sets[set];
+
+        append(buffer, size, &len, "%s\"%s\":{\"count\":%llu", set ? "," : "", latency_set_str[set], (unsigned long long)h->count);
+
+        for (int stage = 0; stage < LATENCY_STAGES_NUM; stage++) {
+            double mean_us = h->count ? (double)h->sum_ns[stage] / h->count / 1000.0 : 0.0;
+
+            append(buffer, size, &len, ",\"%s\":{\"mean_us\":%.1f,\"max_us\":%.1f,\"histogram_us\":[", latency_stage_str[stage], mean_us,
+                   h->max_ns[stage] / 1000.0);
+
+            for (int bucket = 0; bucket < LATENCY_US_BUCKETS; bucket++)
+                append(buffer, size, &len, "%s%llu", bucket ? "," : "", (unsigned long long)h->us[stage][bucket]);
+
+            append(buffer, size, &len, "]}");
+        }
+
+        append(buffer, size, &len, ",\"histogram_frames\":[");
+
+        for (int bucket = 0; bucket < LATENCY_FRAME_BUCKETS; bucket++)
+            append(buffer, size, &len, "%s%llu", bucket ? "," : "", (unsigned long long)h->frames[bucket]);
+
+        append(buffer, size, &len, "]}");
+    }
+
+    append(buffer, size, &len, "}");
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <util/threading.h>
+
+/*
+ * latency of the detection, from the moment the filter gets a frame to the
+ * moment the sources are updated with its result
+ */
+
+enum latency_stage
+{
+    LATENCY_READBACK,   /* capture -> frame in system memory */
+    LATENCY_MATCH,      /* readback -> result ready */
+    LATENCY_APPLY,      /* result ready -> sources updated */
+    LATENCY_TOTAL,      /* capture -> sources updated */
+
+    LATENCY_STAGES_NUM
+};
+
+enum latency_set
+{
+    LATENCY_FRAMES,
+    LATENCY_TRANSITIONS,
+
+    LATENCY_SETS_NUM
+};
+
+/* bucket 0 is below 1 us, bucket i from 2^(i-1) us, the last one is open */
+#define LATENCY_US_BUCKETS      24
+/* 0, 1, 2, 3 and 4 or more frames */
+#define LATENCY_FRAME_BUCKETS   5
+
+struct latency_sample
+{
+    uint64_t capture_ns;
+    uint64_t readback_ns;
+    uint64_t matched_ns;
+    uint64_t applied_ns;
+    uint64_t capture_frame_ns;  /* video frame time at capture */
+    uint64_t applied_frame_ns;  /* video frame time when applied */
+};
+
+struct latency_histogram
+{
+    uint64_t count;
+    uint64_t sum_ns[LATENCY_STAGES_NUM];
+    uint64_t max_ns[LATENCY_STAGES_NUM];
+    uint64_t us[LATENCY_STAGES_NUM][LATENCY_US_BUCKETS];
+    uint64_t frames[LATENCY_FRAME_BUCKETS];
+};
+
+struct latency_stats
+{
+    pthread_mutex_t mutex;
+    struct latency_histogram sets[LATENCY_SETS_NUM];
+};
+
+void latency_stats_init(struct latency_stats *stats);
+void latency_stats_free(struct latency_stats *stats);
+void latency_stats_reset(struct latency_stats *stats);
+
+/*
+ * every sample is added to the frames set, transitions also to their own one.
+ * frame_interval_ns is the duration of a video frame.
+ */
+void latency_stats_add(struct latency_stats *stats, const struct latency_sample *sample, bool transition, uint64_t frame_interval_ns);
+
+void latency_stats_get(struct latency_stats *stats, enum latency_set set, struct latency_histogram *histogram);
+
+/*
+ * JSON description of both sets, truncated to size
+ */
+void latency_stats_format(struct latency_stats *stats, char *buffer, size_t size);
@@ -0,0 +1,198 @@
+#include <obs-module.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "hud-tables.h"
+#include "layout-pack.h"
+
+#define pack_warn(path, format, ...) blog(LOG_WARNING, "[apex-game] layout pack %s: " format, path, ##__VA_ARGS__)
+
+static const uint8_t *map_file(const char *path, size_t *size)
+{
+#ifdef _WIN32
+    wchar_t *wpath = NULL;
+    LARGE_INTEGER file_size;
+    const uint8_t *data = NULL;
+
+    if (!os_utf8_to_wcs_ptr(path, 0, &wpath))
+        return NULL;
+
+    HANDLE file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    bfree(wpath);
+
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+        if (mapping) {
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            *size = (size_t)file_size.QuadPart;
+
+            /* the view keeps the mapping alive */
+            CloseHandle(mapping);
+        }
+    }
+
+    CloseHandle(file);
+
+    return data;
+#else
+    struct stat st;
+    const uint8_t *data = NULL;
+
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return NULL;
+
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *mapped = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (mapped != MAP_FAILED) {
+            data = mapped;
+            *size = (size_t)st.st_size;
+        }
+    }
+
+    close(fd);
+
+    return data;
+#endif
+}
+
+static void unmap_file(const uint8_t *data, size_t size)
+{
+#ifdef _WIN32
+    UNUSED_PARAMETER(size);
+    UnmapViewOfFile(data);
+#else
+    munmap((void *)data, size);
+#endif
+}
+
+static bool table_in_file(const struct layout_pack *pack, uint32_t offset, uint64_t bytes)
+{
+    return (offset & 3) == 0 && (uint64_t)offset + bytes <= pack->size;
+}
+
+/*
+ * a reference is never larger than the frames it is matched on, this also
+ * keeps its size in bytes far from overflowing
+ */
+static bool reference_fits_display(const struct layout_pack_reference *ref)
+{
+    for (int ds = 0; ds < DISPLAY_RESOLUTIONS; ds++)
+        if (ref->width <= display_sizes[ds][0] && ref->height <= display_sizes[ds][1])
+            return true;
+
+    return false;
+}
+
+/*
+ * only the bounds are checked, nothing is decoded: every table is used in
+ * place from the mapped file
+ */
+static bool check_pack(const struct layout_pack *pack, const char *path)
+{
+    const struct layout_pack_header *h = pack->header;
+
+    if (pack->size < sizeof(struct layout_pack_header) || h->magic != LAYOUT_PACK_MAGIC) {
+        pack_warn(path, "not a layout pack");
+        return false;
+    }
+
+    if (h->version != LAYOUT_PACK_VERSION) {
+        pack_warn(path, "unsupported version %u", h->version);
+        return false;
+    }
+
+    if (h->size != pack->size) {
+        pack_warn(path, "truncated file");
+        return false;
+    }
+
+    /* the sizes of the tables below cannot overflow */
+    if (h->resolutions > LAYOUT_PACK_TABLE_MAX || h->languages > LAYOUT_PACK_TABLE_MAX || h->areas_num > LAYOUT_PACK_TABLE_MAX ||
+        h->characters_num > LAYOUT_PACK_TABLE_MAX || h->metrics_num > LAYOUT_PACK_TABLE_MAX) {
+        pack_warn(path, "tables too large");
+        return false;
+    }
+
+    uint64_t areas = (uint64_t)h->resolutions * h->languages * h->areas_num;
+    uint64_t offsets = (uint64_t)h->resolutions * h->areas_num;
+    uint64_t references = (uint64_t)h->resolutions * (h->areas_num + h->characters_num);
+
+    if (!table_in_file(pack, h->areas_offset, areas * sizeof(struct layout_pack_area)) ||
+        !table_in_file(pack, h->offsets_offset, offsets * sizeof(int32_t)) ||
+        !table_in_file(pack, h->thresholds_offset, offsets * h->metrics_num * sizeof(float)) ||
+        !table_in_file(pack, h->references_offset, references * sizeof(struct layout_pack_reference))) {
+        pack_warn(path, "table out of bounds");
+        return false;
+    }
+
+    const struct layout_pack_reference *refs = (const struct layout_pack_reference *)(pack->data + h->references_offset);
+
+    for (uint64_t i = 0; i < references; i++) {
+        uint64_t pixels = (uint64_t)refs[i].width * refs[i].height;
+
+        if (!reference_fits_display(&refs[i])) {
+            pack_warn(path, "reference %u larger than the display", (uint32_t)i);
+            return false;
+        }
+
+        if (pixels && !table_in_file(pack, refs[i].pixels_offset, pixels * sizeof(uint32_t))) {
+            pack_warn(path, "reference %u out of bounds", (uint32_t)i);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+struct layout_pack *layout_pack_open(const char *path)
+{
+    size_t size = 0;
+    const uint8_t *data = map_file(path, &size);
+
+    if (!data) {
+        pack_warn(path, "cannot be mapped");
+        return NULL;
+    }
+
+    struct layout_pack *pack = bzalloc(sizeof(struct layout_pack));
+
+    pack->data = data;
+    pack->size = size;
+    pack->header = (const struct layout_pack_header *)data;
+
+    if (!check_pack(pack, path)) {
+        layout_pack_close(pack);
+        return NULL;
+    }
+
+    return pack;
+}
+
+void layout_pack_close(struct layout_pack *pack)
+{
+    if (!pack)
+        return;
+
+    unmap_file(pack->data, pack->size);
+
+    bfree(pack);
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * a layout pack is a little-endian binary file that is mapped in memory and
+ * used as is: the header is followed by the tables it points to, all the
+ * offsets are in bytes from the beginning of the file and 4 bytes aligned.
+ *
+ *   areas       struct layout_pack_area    [resolutions][languages][areas_num]
+ *   offsets     int32_t                    [resolutions][areas_num]
+ *   thresholds  float                      [resolutions][areas_num][metrics_num]
+ *   references  struct layout_pack_reference [resolutions][areas_num + characters_num]
+ *   pixels      uint32_t leptonica 32 bpp words, row by row without padding
+ *
+ * the references of the banner areas come first, followed by the ones of the
+ * characters. a reference with zero width has no pixels (ie. PG_BANNER_IMAGE
+ * that is compared against the character references).
+ *
+ * the plugin also loads packs with fewer areas, written before the last ones
+ * were added: the missing areas are not placed. psnr_threshold and
+ * ncc_threshold of the header apply to the metrics the thresholds table does
+ * not have.
+ */
+
+#define LAYOUT_PACK_MAGIC       0x4c585041 /* "APXL" */
+#define LAYOUT_PACK_VERSION     2
+#define LAYOUT_PACK_EXTENSION   "apxl"
+
+/* entries per table at most, far above any pack written by the plugin */
+#define LAYOUT_PACK_TABLE_MAX   256
+
+struct layout_pack_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint32_t resolutions;
+    uint32_t languages;
+    uint32_t areas_num;
+    uint32_t characters_num;
+    float psnr_threshold;
+    float ncc_threshold;
+    uint32_t areas_offset;
+    uint32_t offsets_offset;
+    uint32_t references_offset;
+    uint32_t metrics_num;
+    uint32_t thresholds_offset;
+};
+
+struct layout_pack_area
+{
+    uint32_t x;
+    uint32_t y;
+    uint32_t w;
+    uint32_t h;
+};
+
+struct layout_pack_reference
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t pixels_offset;
+};
+
+struct layout_pack
+{
+    const uint8_t *data;
+    size_t size;
+    const struct layout_pack_header *header;
+};
+
+struct layout_pack *layout_pack_open(const char *path);
+void layout_pack_close(struct layout_pack *pack);
+
+static inline const struct layout_pack_area *layout_pack_areas(const struct layout_pack *pack, uint32_t resolution, uint32_t language)
+{
+    const struct layout_pack_header *h = pack->header;
+    const struct layout_pack_area *areas = (const struct layout_pack_area *)(pack->data + h->areas_offset);
+
+    return areas + (resolution * h->languages + language) * h->areas_num;
+}
+
+static inline const int32_t *layout_pack_offsets(const struct layout_pack *pack, uint32_t resolution)
+{
+    const struct layout_pack_header *h = pack->header;
+    const int32_t *offsets = (const int32_t *)(pack->data + h->offsets_offset);
+
+    return offsets + resolution * h->areas_num;
+}
+
+/*
+ * the thresholds of an area are indexed by metric
+ */
+static inline const float *layout_pack_thresholds(const struct layout_pack *pack, uint32_t resolution)
+{
+    const struct layout_pack_header *h = pack->header;
+
+    return (const float *)(pack->data + h->thresholds_offset) + resolution * h->areas_num * h->metrics_num;
+}
+
+static inline const struct layout_pack_reference *layout_pack_reference(const struct layout_pack *pack, uint32_t resolution, uint32_t index)
+{
+    const struct layout_pack_header *h = pack->header;
+    const struct layout_pack_reference *references = (const struct layout_pack_reference *)(pack->data + h->references_offset);
+
+    return references + resolution * (h->areas_num + h->characters_num) + index;
+}
+
+static inline const uint32_t *layout_pack_pixels(const struct layout_pack *pack, const struct layout_pack_reference *ref)
+{
+    return (const uint32_t *)(pack->data + ref->pixels_offset);
+}
@@ -0,0 +1,173 @@
+#include <string.h>
+
+#include "lz4-block.h"
+
+#define LZ4_HASH_LOG        12
+#define LZ4_MIN_MATCH       4
+#define LZ4_LAST_LITERALS   5
+#define LZ4_MF_LIMIT        12
+#define LZ4_MAX_OFFSET      65535
+
+static uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+
+    return v;
+}
+
+static uint32_t hash_sequence(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - LZ4_HASH_LOG);
+}
+
+static size_t write_length(uint8_t *dst, size_t op, size_t length)
+{
+    while (length >= 255) {
+        dst[op++] = 255;
+        length -= 255;
+    }
+
+    dst[op++] = (uint8_t)length;
+
+    return op;
+}
+
+static size_t write_sequence(uint8_t *dst, size_t op, const uint8_t *literals, size_t literals_len, size_t offset, size_t match_len)
+{
+    size_t token = op++;
+    size_t match_code = match_len ? match_len - LZ4_MIN_MATCH : 0;
+
+    dst[token] = (uint8_t)((literals_len < 15 ? literals_len : 15) << 4);
+
+    if (literals_len >= 15)
+        op = write_length(dst, op, literals_len - 15);
+
+    memcpy(dst + op, literals, literals_len);
+    op += literals_len;
+
+    /* the last sequence has only literals */
+    if (!match_len)
+        return op;
+
+    dst[token] |= (uint8_t)(match_code < 15 ? match_code : 15);
+
+    dst[op++] = (uint8_t)(offset & 0xff);
+    dst[op++] = (uint8_t)(offset >> 8);
+
+    if (match_code >= 15)
+        op = write_length(dst, op, match_code - 15);
+
+    return op;
+}
+
+/*
+ * greedy single pass with a hash table of the last position of each 4 bytes
+ * sequence. dst must hold lz4_compress_bound(size) bytes.
+ */
+size_t lz4_compress(const uint8_t *src, size_t size, uint8_t *dst)
+{
+    uint32_t table[1 << LZ4_HASH_LOG];
+    size_t ip = 0, anchor = 0, op = 0;
+
+    memset(table, 0, sizeof(table));
+
+    if (size > LZ4_MF_LIMIT) {
+        size_t match_start_limit = size - LZ4_MF_LIMIT;
+        size_t match_end_limit = size - LZ4_LAST_LITERALS;
+
+        while (ip < match_start_limit) {
+            uint32_t sequence = read32(src + ip);
+            uint32_t h = hash_sequence(sequence);
+            size_t ref = table[h];
+
+            /* positions are stored + 1, zero is an empty entry */
+            table[h] = (uint32_t)(ip + 1);
+
+            if (!ref || ip - (ref - 1) > LZ4_MAX_OFFSET || read32(src + ref - 1) != sequence) {
+                ip++;
+                continue;
+            }
+
+            ref--;
+
+            size_t match_len = LZ4_MIN_MATCH;
+
+            while (ip + match_len < match_end_limit && src[ref + match_len] == src[ip + match_len])
+                match_len++;
+
+            op = write_sequence(dst, op, src + anchor, ip - anchor, ip - ref, match_len);
+
+            ip += match_len;
+            anchor = ip;
+        }
+    }
+
+    return write_sequence(dst, op, src + anchor, size - anchor, 0, 0);
+}
+
+static bool read_length(const uint8_t *src, size_t size, size_t *ip, size_t *length)
+{
+    uint8_t b;
+
+    do {
+        if (*ip >= size)
+            return false;
+
+        b = src[(*ip)++];
+        *length += b;
+    } while (b == 255);
+
+    return true;
+}
+
+bool lz4_decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t dst_size)
+{
+    size_t ip = 0, op = 0;
+
+    while (ip < size) {
+        uint8_t token = src[ip++];
+        size_t literals_len = token >> 4;
+
+        if (literals_len == 15 && !read_length(src, size, &ip, &literals_len))
+            return false;
+
+        if (literals_len > size - ip || literals_len > dst_size - op)
+            return false;
+
+        memcpy(dst + op, src + ip, literals_len);
+        ip += literals_len;
+        op += literals_len;
+
+        if (ip == size)
+            break;
+
+        if (size - ip < 2)
+            return false;
+
+        size_t offset = src[ip] | (src[ip + 1] << 8);
+        ip += 2;
+
+        if (!offset || offset > op)
+            return false;
+
+        size_t match_len = token & 15;
+
+        if (match_len == 15 && !read_length(src, size, &ip, &match_len))
+            return false;
+
+        match_len += LZ4_MIN_MATCH;
+
+        if (match_len > dst_size - op)
+            return false;
+
+        /* the match may overlap the bytes it produces */
+        for (size_t i = 0; i < match_len; i++)
+            dst[op + i] = dst[op - offset + i];
+
+        op += match_len;
+    }
+
+    return op == dst_size;
+}
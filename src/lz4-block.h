@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * minimal encoder and decoder of the LZ4 block format, the output can be
+ * decoded by any LZ4 implementation (LZ4_decompress_safe)
+ */
+
+static inline size_t lz4_compress_bound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+size_t lz4_compress(const uint8_t *src, size_t size, uint8_t *dst);
+bool lz4_decompress(const uint8_t *src, size_t size, uint8_t *dst, size_t dst_size);
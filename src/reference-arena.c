@@ -0,0 +1,57 @@
+#include <string.h>
+
+#include <util/bmem.h>
+
+#include "reference-arena.h"
+
+static size_t align_size(size_t size)
+{
+    return (size + REFERENCE_ARENA_ALIGNMENT - 1) & ~(size_t)(REFERENCE_ARENA_ALIGNMENT - 1);
+}
+
+/*
+ * the sizes of the planes are known before the allocation, the block has the
+ * slack to move the data on a cache line: bmalloc() does not align that much
+ */
+void reference_arena_build(struct reference_arena *arena, const struct reference_source *sources, uint32_t count, uint32_t mask_min_luma)
+{
+    size_t table_size = align_size(count * sizeof(struct reference_entry));
+    size_t size = 0;
+
+    memset(arena, 0, sizeof(*arena));
+
+    for (uint32_t i = 0; i < count; i++)
+        if (sources[i].pixels && sources[i].w && sources[i].h)
+            size += align_size((size_t)sources[i].w * sources[i].h) * REFERENCE_PLANES_NUM;
+
+    arena->block = bzalloc(REFERENCE_ARENA_ALIGNMENT + table_size + size);
+    arena->data = (uint8_t *)(((uintptr_t)arena->block + REFERENCE_ARENA_ALIGNMENT - 1) & ~(uintptr_t)(REFERENCE_ARENA_ALIGNMENT - 1));
+    arena->entries = (struct reference_entry *)arena->data;
+    arena->data += table_size;
+    arena->count = count;
+    arena->size = size;
+
+    size = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        struct reference_entry *entry = &arena->entries[i];
+
+        if (!sources[i].pixels || !sources[i].w || !sources[i].h)
+            continue;
+
+        entry->w = sources[i].w;
+        entry->h = sources[i].h;
+        entry->offset = size;
+        entry->plane_size = align_size((size_t)entry->w * entry->h);
+
+        area_reference_planes(arena->data + entry->offset, entry->plane_size, sources[i].pixels, sources[i].wpl, entry->w, entry->h, mask_min_luma);
+
+        size += entry->plane_size * REFERENCE_PLANES_NUM;
+    }
+}
+
+void reference_arena_free(struct reference_arena *arena)
+{
+    bfree(arena->block);
+    memset(arena, 0, sizeof(*arena));
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "area-scores.h"
+
+/*
+ * all the references of one display resolution in a single allocation: an
+ * index table followed by the planes of every reference (see area-scores.h).
+ * every plane starts on a cache line and its rows follow each other without
+ * padding, a comparison reads the planes sequentially.
+ */
+
+#define REFERENCE_ARENA_ALIGNMENT   64
+
+struct reference_entry
+{
+    uint32_t w;
+    uint32_t h;
+    size_t offset;          /* of the red plane from the data of the arena */
+    size_t plane_size;      /* distance between two planes */
+};
+
+struct reference_arena
+{
+    void *block;
+    struct reference_entry *entries;
+    uint8_t *data;
+    uint32_t count;
+    size_t size;
+};
+
+/*
+ * pixels are leptonica 32 bpp words (r << 24 | g << 16 | b << 8), a source
+ * without pixels leaves its entry empty
+ */
+struct reference_source
+{
+    const uint32_t *pixels;
+    uint32_t wpl;
+    uint32_t w;
+    uint32_t h;
+};
+
+void reference_arena_build(struct reference_arena *arena, const struct reference_source *sources, uint32_t count, uint32_t mask_min_luma);
+void reference_arena_free(struct reference_arena *arena);
+
+/*
+ * NULL for an empty entry
+ */
+static inline const struct reference_entry *reference_arena_entry(const struct reference_arena *arena, uint32_t index)
+{
+    return index < arena->count && arena->entries[index].w ? &arena->entries[index] : NULL;
+}
+
+static inline const uint8_t *reference_arena_plane(const struct reference_arena *arena, const struct reference_entry *entry, enum reference_plane plane)
+{
+    return arena->data + entry->offset + plane * entry->plane_size;
+}
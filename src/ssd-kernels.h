@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * sum of the squared differences of the three channels of an area and of its
+ * reference. the pixels of the area are leptonica 32 bpp words (r << 24 |
+ * g << 16 | b << 8), the reference is planar (see area-scores.h): red,
+ * green and blue planes plane_size bytes apart, rows of w bytes.
+ *
+ * ssd_kernel_generic() takes the size of the area at run time, SSD_KERNEL()
+ * defines a kernel with the size fixed at compile time: the rows are inlined
+ * with constant bounds and the compiler unrolls and vectorizes them. a row
+ * fits in 32 bits up to 22000 pixels.
+ */
+
+#ifdef _MSC_VER
+#define SSD_INLINE  static __forceinline
+#else
+#define SSD_INLINE  static inline __attribute__((always_inline))
+#endif
+
+SSD_INLINE uint64_t ssd_rows(const uint32_t *image, uint32_t image_wpl, const uint8_t *planes, size_t plane_size, uint32_t w, uint32_t h)
+{
+    uint64_t ssd = 0;
+
+    for (uint32_t y = 0; y < h; y++) {
+        const uint32_t *line = image + (size_t)y * image_wpl;
+        const uint8_t *red = planes + (size_t)y * w, *green = red + plane_size, *blue = green + plane_size;
+        uint32_t row = 0;
+
+        for (uint32_t x = 0; x < w; x++) {
+            int32_t dr = (int32_t)(line[x] >> 24) - red[x];
+            int32_t dg = (int32_t)((line[x] >> 16) & 0xff) - green[x];
+            int32_t db = (int32_t)((line[x] >> 8) & 0xff) - blue[x];
+
+            row += (uint32_t)(dr * dr + dg * dg + db * db);
+        }
+
+        ssd += row;
+    }
+
+    return ssd;
+}
+
+typedef uint64_t (*ssd_kernel_t)(const uint32_t *image, uint32_t image_wpl, const uint8_t *planes, size_t plane_size);
+
+struct ssd_kernel
+{
+    uint32_t w;
+    uint32_t h;
+    ssd_kernel_t run;
+};
+
+#define SSD_KERNEL(name, width, height) \
+    static uint64_t ssd_kernel_##name(const uint32_t *image, uint32_t image_wpl, const uint8_t *planes, size_t plane_size) \
+    { \
+        return ssd_rows(image, image_wpl, planes, plane_size, (width), (height)); \
+    }
+
+#define SSD_KERNEL_ENTRY(name, width, height) \
+    { (width), (height), ssd_kernel_##name },
+
+static inline uint64_t ssd_kernel_generic(const uint32_t *image, uint32_t image_wpl, const uint8_t *planes, size_t plane_size, uint32_t w, uint32_t h)
+{
+    return ssd_rows(image, image_wpl, planes, plane_size, w, h);
+}
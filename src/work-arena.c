@@ -0,0 +1,44 @@
+#include <string.h>
+
+#include <util/bmem.h>
+
+#include "work-arena.h"
+
+void work_arena_reset(struct work_arena *arena, size_t size)
+{
+    size = work_arena_size(size);
+
+    if (size > arena->capacity) {
+        bfree(arena->block);
+
+        /* bmalloc() does not align on a cache line */
+        arena->block = bzalloc(size + WORK_ARENA_ALIGNMENT);
+        arena->base = (uint8_t *)(((uintptr_t)arena->block + WORK_ARENA_ALIGNMENT - 1) & ~(uintptr_t)(WORK_ARENA_ALIGNMENT - 1));
+        arena->capacity = size;
+        arena->allocations++;
+    }
+
+    arena->used = 0;
+}
+
+void work_arena_free(struct work_arena *arena)
+{
+    bfree(arena->block);
+    memset(arena, 0, sizeof(*arena));
+}
+
+void *work_arena_alloc(struct work_arena *arena, size_t size)
+{
+    size = work_arena_size(size);
+
+    if (size > arena->capacity - arena->used) {
+        arena->overflows++;
+        return NULL;
+    }
+
+    void *piece = arena->base + arena->used;
+
+    arena->used += size;
+
+    return piece;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * working memory of a filter: a single block sized up front for the current
+ * configuration and carved in cache line aligned pieces. a reset drops all
+ * the pieces and only allocates when the block has to grow, the frame loop
+ * carves nothing and allocates nothing.
+ */
+
+#define WORK_ARENA_ALIGNMENT    64
+
+struct work_arena
+{
+    void *block;
+    uint8_t *base;
+    size_t capacity;
+    size_t used;
+    uint64_t allocations;   /* blocks allocated */
+    uint64_t overflows;     /* pieces refused for lack of space */
+};
+
+/*
+ * size taken by a piece of the given size, sum them to size the arena
+ */
+static inline size_t work_arena_size(size_t size)
+{
+    return (size + WORK_ARENA_ALIGNMENT - 1) & ~(size_t)(WORK_ARENA_ALIGNMENT - 1);
+}
+
+void work_arena_reset(struct work_arena *arena, size_t size);
+void work_arena_free(struct work_arena *arena);
+
+/*
+ * NULL when the arena was not sized for the piece
+ */
+void *work_arena_alloc(struct work_arena *arena, size_t size);
@@ -0,0 +1,308 @@
+#include <obs-module.h>
+
+#include <util/bmem.h>
+#include <util/threading.h>
+
+#include "worker-pool.h"
+
+#define WORKER_QUEUE_INITIAL_CAPACITY   16
+
+struct worker_job
+{
+    worker_job_func_t func;
+    void *param;
+    struct worker_group *group;
+};
+
+struct worker_queue
+{
+    pthread_mutex_t mutex;
+    struct worker_job *jobs;
+    size_t head;
+    size_t count;
+    size_t capacity;
+};
+
+struct worker_thread_param
+{
+    struct worker_pool *pool;
+    int index;
+};
+
+struct worker_pool
+{
+    int num_workers;
+    pthread_t *threads;
+    struct worker_thread_param *params;
+    struct worker_queue *queues;
+    pthread_mutex_t sleep_mutex;
+    pthread_cond_t sleep_cond;
+    long queued;
+    long next_queue;
+    bool stop;
+};
+
+static void queue_push_back(struct worker_queue *q, const struct worker_job *job)
+{
+    pthread_mutex_lock(&q->mutex);
+
+    if (q->count == q->capacity) {
+        size_t capacity = q->capacity ? q->capacity * 2 : WORKER_QUEUE_INITIAL_CAPACITY;
+        struct worker_job *jobs = bmalloc(capacity * sizeof(struct worker_job));
+
+        for (size_t i = 0; i < q->count; i++)
+            jobs[i] = q->jobs[(q->head + i) % q->capacity];
+
+        bfree(q->jobs);
+
+        q->jobs = jobs;
+        q->head = 0;
+        q->capacity = capacity;
+    }
+
+    q->jobs[(q->head + q->count) % q->capacity] = *job;
+    q->count++;
+
+    pthread_mutex_unlock(&q->mutex);
+}
+
+/*
+ * the owner takes the most recent job from the back of its own queue, other
+ * threads steal the oldest one from the front. when group is set only a job
+ * belonging to that group is taken.
+ */
+static bool queue_pop(struct worker_queue *q, bool back, struct worker_group *group, struct worker_job *job)
+{
+    bool found = false;
+
+    pthread_mutex_lock(&q->mutex);
+
+    for (size_t n = 0; n < q->count; n++) {
+        size_t i = back ? (q->count - 1 - n) : n;
+        size_t slot = (q->head + i) % q->capacity;
+
+        if (group && q->jobs[slot].group != group)
+            continue;
+
+        *job = q->jobs[slot];
+
+        for (size_t j = i; j + 1 < q->count; j++)
+            q->jobs[(q->head + j) % q->capacity] = q->jobs[(q->head + j + 1) % q->capacity];
+
+        q->count--;
+        found = true;
+        break;
+    }
+
+    pthread_mutex_unlock(&q->mutex);
+
+    return found;
+}
+
+static void group_complete(struct worker_group *group)
+{
+    pthread_mutex_lock(&group->mutex);
+
+    if (--group->pending == 0)
+        pthread_cond_broadcast(&group->cond);
+
+    pthread_mutex_unlock(&group->mutex);
+}
+
+static bool try_run_job(struct worker_pool *pool, int own, struct worker_group *group)
+{
+    struct worker_job job;
+    bool found = false;
+
+    if (own >= 0)
+        found = queue_pop(&pool->queues[own], true, group, &job);
+
+    for (int n = 0; !found && n < pool->num_workers; n++) {
+        int victim = own >= 0 ? (own + 1 + n) % pool->num_workers : n;
+
+        if (victim != own)
+            found = queue_pop(&pool->queues[victim], false, group, &job);
+    }
+
+    if (!found)
+        return false;
+
+    pthread_mutex_lock(&pool->sleep_mutex);
+    pool->queued--;
+    pthread_mutex_unlock(&pool->sleep_mutex);
+
+    job.func(job.param);
+
+    group_complete(job.group);
+
+    return true;
+}
+
+static void *worker_thread(void *data)
+{
+    struct worker_thread_param *param = data;
+    struct worker_pool *pool = param->pool;
+
+    os_set_thread_name("apex-game: worker");
+
+    for (;;) {
+        if (try_run_job(pool, param->index, NULL))
+            continue;
+
+        pthread_mutex_lock(&pool->sleep_mutex);
+
+        while (!pool->stop && pool->queued == 0)
+            pthread_cond_wait(&pool->sleep_cond, &pool->sleep_mutex);
+
+        bool stop = pool->stop;
+
+        pthread_mutex_unlock(&pool->sleep_mutex);
+
+        if (stop)
+            break;
+    }
+
+    return NULL;
+}
+
+struct worker_pool *worker_pool_create(int num_workers)
+{
+    if (num_workers < 1)
+        num_workers = 1;
+
+    struct worker_pool *pool = bzalloc(sizeof(struct worker_pool));
+
+    pool->num_workers = num_workers;
+    pool->threads = bzalloc(num_workers * sizeof(pthread_t));
+    pool->params = bzalloc(num_workers * sizeof(struct worker_thread_param));
+    pool->queues = bzalloc(num_workers * sizeof(struct worker_queue));
+
+    pthread_mutex_init(&pool->sleep_mutex, NULL);
+    pthread_cond_init(&pool->sleep_cond, NULL);
+
+    for (int i = 0; i < num_workers; i++)
+        pthread_mutex_init(&pool->queues[i].mutex, NULL);
+
+    for (int i = 0; i < num_workers; i++) {
+        pool->params[i].pool = pool;
+        pool->params[i].index = i;
+
+        if (pthread_create(&pool->threads[i], NULL, worker_thread, &pool->params[i]) != 0) {
+            pool->num_workers = i;
+            break;
+        }
+    }
+
+    if (!pool->num_workers) {
+        worker_pool_destroy(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+void worker_pool_destroy(struct worker_pool *pool)
+{
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->sleep_mutex);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->sleep_cond);
+    pthread_mutex_unlock(&pool->sleep_mutex);
+
+    for (int i = 0; i < pool->num_workers; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    for (int i = 0; i < pool->num_workers; i++) {
+        pthread_mutex_destroy(&pool->queues[i].mutex);
+        bfree(pool->queues[i].jobs);
+    }
+
+    pthread_cond_destroy(&pool->sleep_cond);
+    pthread_mutex_destroy(&pool->sleep_mutex);
+
+    bfree(pool->queues);
+    bfree(pool->params);
+    bfree(pool->threads);
+    bfree(pool);
+}
+
+int worker_pool_size(const struct worker_pool *pool)
+{
+    return pool ? pool->num_workers : 0;
+}
+
+void worker_group_init(struct worker_group *group)
+{
+    pthread_mutex_init(&group->mutex, NULL);
+    pthread_cond_init(&group->cond, NULL);
+    group->pending = 0;
+}
+
+void worker_group_free(struct worker_group *group)
+{
+    pthread_cond_destroy(&group->cond);
+    pthread_mutex_destroy(&group->mutex);
+}
+
+bool worker_group_busy(struct worker_group *group)
+{
+    pthread_mutex_lock(&group->mutex);
+    bool busy = group->pending > 0;
+    pthread_mutex_unlock(&group->mutex);
+
+    return busy;
+}
+
+/*
+ * without a pool the job is executed immediately by the caller
+ */
+void worker_pool_submit(struct worker_pool *pool, struct worker_group *group, worker_job_func_t func, void *param)
+{
+    pthread_mutex_lock(&group->mutex);
+    group->pending++;
+    pthread_mutex_unlock(&group->mutex);
+
+    if (!pool) {
+        func(param);
+        group_complete(group);
+        return;
+    }
+
+    struct worker_job job =
+    {
+        .func = func,
+        .param = param,
+        .group = group,
+    };
+
+    long queue = os_atomic_inc_long(&pool->next_queue) % pool->num_workers;
+
+    queue_push_back(&pool->queues[queue], &job);
+
+    pthread_mutex_lock(&pool->sleep_mutex);
+    pool->queued++;
+    pthread_cond_signal(&pool->sleep_cond);
+    pthread_mutex_unlock(&pool->sleep_mutex);
+}
+
+/*
+ * while waiting the caller helps executing the jobs of the group that are
+ * still queued, this way nested groups submitted from a worker cannot
+ * deadlock when all the workers are busy
+ */
+void worker_group_wait(struct worker_pool *pool, struct worker_group *group)
+{
+    while (pool && worker_group_busy(group)) {
+        if (!try_run_job(pool, -1, group))
+            break;
+    }
+
+    pthread_mutex_lock(&group->mutex);
+
+    while (group->pending > 0)
+        pthread_cond_wait(&group->cond, &group->mutex);
+
+    pthread_mutex_unlock(&group->mutex);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include <util/threading.h>
+
+typedef void (*worker_job_func_t)(void *param);
+
+/*
+ * a group tracks the jobs submitted together, waiting on it returns when all
+ * of them have been executed
+ */
+struct worker_group
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    long pending;
+};
+
+struct worker_pool;
+
+struct worker_pool *worker_pool_create(int num_workers);
+void worker_pool_destroy(struct worker_pool *pool);
+int worker_pool_size(const struct worker_pool *pool);
+
+void worker_group_init(struct worker_group *group);
+void worker_group_free(struct worker_group *group);
+bool worker_group_busy(struct worker_group *group);
+
+void worker_pool_submit(struct worker_pool *pool, struct worker_group *group, worker_job_func_t func, void *param);
+void worker_group_wait(struct worker_pool *pool, struct worker_group *group);
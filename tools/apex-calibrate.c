@@ -0,0 +1,375 @@
+/*
+ * derives the threshold of every area of a layout pack from labelled frames.
+ *
+ *   apex-calibrate <input.apxl> <labels.txt> <output.apxl>
+ *
+ * each line of the labels file names a full frame capture (1080p or 1440p),
+ * the game language and the state of some of the areas:
+ *
+ *   captures/looting_01.png en ESC_LOOTING_BUTTON=1 M_MAP_BUTTON=0
+ *   captures/game_07.png it PG_BANNER_IMAGE=wraith MAP_GAME_BUTTON=1
+ *   captures/lobby_02.png en PG_BANNER_IMAGE=none
+ *
+ * a place line moves or sizes an area of the pack for one resolution and one
+ * language (or all of them), before the frames are scored. the areas without
+ * a reference (ie. the counters, that the built-in layout does not place) can
+ * take any size, the others keep the size of their reference. the frames
+ * after the line are scored on the new area:
+ *
+ *   place 1920x1080 all SQUADS_LEFT_IMAGE 1700 40 110 30
+ *
+ * the PSNR, luma NCC and glyph mask scores of the labelled areas are computed as the
+ * plugin does (at the default position and at the layout offset) and for
+ * every area and metric the threshold with the fewest errors is chosen, in
+ * the middle of the widest gap between the scores. the output pack is a copy
+ * of the input with the new thresholds and the placed areas.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tools-common.h"
+
+#define LINE_LEN            4096
+
+struct samples
+{
+    float *scores;
+    size_t count;
+    size_t capacity;
+};
+
+struct calibration
+{
+    struct samples positives;
+    struct samples negatives;
+};
+
+static struct calibration calibrations[DISPLAY_RESOLUTIONS][AREAS_NUM][METRICS_NUM];
+
+static void add_sample(struct samples *s, float score)
+{
+    if (s->count == s->capacity) {
+        s->capacity = s->capacity ? s->capacity * 2 : 64;
+        s->scores = realloc(s->scores, s->capacity * sizeof(float));
+    }
+
+    s->scores[s->count++] = score;
+}
+
+static void add_scores(uint32_t ds, uint32_t an, const float scores[METRICS_NUM], bool positive)
+{
+    for (int mm = 0; mm < METRICS_NUM; mm++) {
+        struct calibration *c = &calibrations[ds][an][mm];
+
+        add_sample(positive ? &c->positives : &c->negatives, scores[mm]);
+    }
+}
+
+static bool process_label(PIX *frame, uint32_t ds, uint32_t gl, const char *label)
+{
+    char name[64];
+    const char *value = strchr(label, '=');
+
+    if (!value || (size_t)(value - label) >= sizeof(name))
+        return false;
+
+    memcpy(name, label, value - label);
+    name[value - label] = '\0';
+    value++;
+
+    int an = find_name(area_name_str, AREAS_NUM, name);
+
+    if (an < 0)
+        return false;
+
+    const struct layout_pack_area *a = &layout_pack_areas(&pack, ds, gl)[an];
+    int32_t xoff = layout_pack_offsets(&pack, ds)[an];
+    float scores[METRICS_NUM];
+
+    if (an != PG_BANNER_IMAGE) {
+        if (!references[ds][an].pix || (strcmp(value, "0") != 0 && strcmp(value, "1") != 0))
+            return false;
+
+        score_area(frame, &references[ds][an], a, xoff, scores);
+        add_scores(ds, an, scores, value[0] == '1');
+
+        return true;
+    }
+
+    /*
+     * the character banner is matched against every character: the labelled
+     * one gives a positive sample, all the others a negative one
+     */
+    int pg = strcmp(value, "none") == 0 ? (int)CHARACTERS_NUM : find_name(character_name_str, CHARACTERS_NUM, value);
+
+    if (pg < 0)
+        return false;
+
+    for (uint32_t c = 0; c < CHARACTERS_NUM; c++) {
+        const struct pack_reference *reference = &references[ds][AREAS_NUM + c];
+
+        if (!reference->pix)
+            continue;
+
+        score_area(frame, reference, a, 0, scores);
+        add_scores(ds, an, scores, (int)c == pg);
+    }
+
+    return true;
+}
+
+static bool place_area(void)
+{
+    const char *size = strtok(NULL, " \t\r\n");
+    const char *language = strtok(NULL, " \t\r\n");
+    const char *name = strtok(NULL, " \t\r\n");
+    const char *values[4];
+    struct layout_pack_area area;
+    uint32_t width, height;
+
+    for (int i = 0; i < 4; i++)
+        values[i] = strtok(NULL, " \t\r\n");
+
+    if (!size || !language || !name || !values[3] || sscanf(size, "%ux%u", &width, &height) != 2)
+        return false;
+
+    if (sscanf(values[0], "%u", &area.x) != 1 || sscanf(values[1], "%u", &area.y) != 1 || sscanf(values[2], "%u", &area.w) != 1 ||
+        sscanf(values[3], "%u", &area.h) != 1)
+        return false;
+
+    int ds = find_display(width, height);
+    int gl = strcmp(language, "all") == 0 ? LANGUAGES : find_name(game_language_str, LANGUAGES, language);
+    int an = find_name(area_name_str, AREAS_NUM, name);
+
+    if (ds < 0 || gl < 0 || an < 0 || !area.w || !area.h)
+        return false;
+
+    /* the plugin refuses the pack when the area leaves the frame, also once moved by its offset */
+    int32_t xoff = layout_pack_offsets(&pack, ds)[an];
+
+    if ((int64_t)area.x + (xoff < 0 ? xoff : 0) < 0 || (uint64_t)area.x + area.w + (xoff > 0 ? xoff : 0) > width ||
+        (uint64_t)area.y + area.h > height)
+        return false;
+
+    PIX *reference = references[ds][an].pix;
+
+    if (reference && (pixGetWidth(reference) != (l_int32)area.w || pixGetHeight(reference) != (l_int32)area.h))
+        return false;
+
+    for (int l = 0; l < LANGUAGES; l++) {
+        if (gl != LANGUAGES && l != gl)
+            continue;
+
+        struct layout_pack_area *areas = (struct layout_pack_area *)layout_pack_areas(&pack, ds, l);
+
+        areas[an] = area;
+    }
+
+    return true;
+}
+
+static bool process_labels(const char *path)
+{
+    char line[LINE_LEN];
+    int line_number = 0;
+    FILE *f = fopen(path, "r");
+
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        line_number++;
+
+        char *frame_path = strtok(line, " \t\r\n");
+
+        if (!frame_path || frame_path[0] == '#')
+            continue;
+
+        if (strcmp(frame_path, "place") == 0) {
+            if (!place_area())
+                fprintf(stderr, "%s:%d: invalid place line\n", path, line_number);
+
+            continue;
+        }
+
+        char *language = strtok(NULL, " \t\r\n");
+        int gl = language ? find_name(game_language_str, LANGUAGES, language) : -1;
+
+        if (gl < 0) {
+            fprintf(stderr, "%s:%d: unknown language\n", path, line_number);
+            continue;
+        }
+
+        PIX *image = pixRead(frame_path);
+
+        if (!image) {
+            fprintf(stderr, "%s:%d: unable to read %s\n", path, line_number, frame_path);
+            continue;
+        }
+
+        PIX *frame = pixConvertTo32(image);
+        int ds = find_display(pixGetWidth(frame), pixGetHeight(frame));
+
+        if (ds < 0) {
+            fprintf(stderr, "%s:%d: unsupported frame size %dx%d\n", path, line_number, pixGetWidth(frame), pixGetHeight(frame));
+        } else {
+            for (char *label = strtok(NULL, " \t\r\n"); label; label = strtok(NULL, " \t\r\n"))
+                if (!process_label(frame, ds, gl, label))
+                    fprintf(stderr, "%s:%d: invalid label %s\n", path, line_number, label);
+        }
+
+        pixDestroy(&frame);
+        pixDestroy(&image);
+    }
+
+    fclose(f);
+
+    return true;
+}
+
+static int compare_scores(const void *a, const void *b)
+{
+    float fa = *(const float *)a;
+    float fb = *(const float *)b;
+
+    return (fa > fb) - (fa < fb);
+}
+
+/*
+ * the threshold is placed between two consecutive scores, below the lowest
+ * one (everything matches) or on the highest one (nothing matches), a sample
+ * matches when its score is greater than the threshold. among the cuts with
+ * the fewest errors the one with the widest gap is taken, the two outer cuts
+ * have no gap and lose the ties. false when a side has no samples or out of
+ * memory.
+ */
+static bool calibrate(struct calibration *c, float *threshold, size_t *errors, float *gap)
+{
+    size_t n = c->positives.count + c->negatives.count;
+
+    if (!c->positives.count || !c->negatives.count)
+        return false;
+
+    struct
+    {
+        float score;
+        bool positive;
+    } *all = malloc(n * sizeof(*all));
+
+    if (!all)
+        return false;
+
+    qsort(c->positives.scores, c->positives.count, sizeof(float), compare_scores);
+    qsort(c->negatives.scores, c->negatives.count, sizeof(float), compare_scores);
+
+    /* merge of the two sorted lists */
+    for (size_t i = 0, p = 0, q = 0; i < n; i++) {
+        bool take_positive = q == c->negatives.count || (p < c->positives.count && c->positives.scores[p] < c->negatives.scores[q]);
+
+        all[i].positive = take_positive;
+        all[i].score = take_positive ? c->positives.scores[p++] : c->negatives.scores[q++];
+    }
+
+    /* cut after the i-th sample: the ones up to i do not match */
+    size_t missed = 0;
+    size_t false_matches = c->negatives.count;
+
+    *errors = c->negatives.count;
+    *gap = 0.0f;
+    *threshold = nextafterf(all[0].score, -INFINITY);
+
+    if (c->positives.count < *errors) {
+        *errors = c->positives.count;
+        *threshold = all[n - 1].score;
+    }
+
+    for (size_t i = 0; i + 1 < n; i++) {
+        if (all[i].positive)
+            missed++;
+        else
+            false_matches--;
+
+        if (all[i + 1].score == all[i].score)
+            continue;
+
+        size_t e = missed + false_matches;
+        float g = all[i + 1].score - all[i].score;
+
+        if (e < *errors || (e == *errors && g > *gap)) {
+            *errors = e;
+            *gap = g;
+            *threshold = (all[i].score + all[i + 1].score) / 2.0f;
+        }
+    }
+
+    free(all);
+
+    return true;
+}
+
+static bool write_pack(const char *path)
+{
+    const struct layout_pack_header *h = pack.header;
+    float *thresholds = (float *)(pack.data + h->thresholds_offset);
+
+    for (uint32_t ds = 0; ds < DISPLAY_RESOLUTIONS; ds++) {
+        for (uint32_t an = 0; an < AREAS_NUM; an++) {
+            for (int mm = 0; mm < METRICS_NUM; mm++) {
+                float threshold = 0.0f, gap = 0.0f;
+                size_t errors = 0;
+                struct calibration *c = &calibrations[ds][an][mm];
+                float *current = &thresholds[(ds * AREAS_NUM + an) * h->metrics_num + mm];
+
+                if (!calibrate(c, &threshold, &errors, &gap)) {
+                    if (c->positives.count || c->negatives.count)
+                        printf("%ux%u %-26s %-4s kept %.3f (%zu positives, %zu negatives)\n", display_sizes[ds][0], display_sizes[ds][1],
+                               area_name_str[an], match_metric_str[mm], *current, c->positives.count, c->negatives.count);
+                    continue;
+                }
+
+                printf("%ux%u %-26s %-4s %.3f -> %.3f (%zu positives, %zu negatives, %zu errors, gap %.3f)\n", display_sizes[ds][0], display_sizes[ds][1],
+                       area_name_str[an], match_metric_str[mm], *current, threshold, c->positives.count, c->negatives.count, errors, gap);
+
+                *current = threshold;
+            }
+        }
+    }
+
+    FILE *f = fopen(path, "wb");
+
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    bool success = fwrite(pack.data, 1, pack.size, f) == pack.size;
+
+    fclose(f);
+
+    return success;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 4) {
+        fprintf(stderr, "usage: %s <input.apxl> <labels.txt> <output.apxl>\n", argv[0]);
+        return 1;
+    }
+
+    if (!load_pack(argv[1]))
+        return 1;
+
+    if (!process_labels(argv[2]))
+        return 1;
+
+    if (!write_pack(argv[3]))
+        return 1;
+
+    return 0;
+}
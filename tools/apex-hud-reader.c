@@ -0,0 +1,148 @@
+/*
+ * example reader of the shared memory export of the plugin, prints the state
+ * published by the filter every time a new frame is analysed.
+ *
+ *   apex-hud-reader <name> [-1]
+ *
+ * <name> is the "Segment name" of the filter settings, -1 prints the current
+ * state once and exits. the reader never blocks the plugin: a copy taken
+ * while the state was being written is simply read again.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "../src/hud-export.h"
+
+#define POLL_INTERVAL_MS    5
+
+static const struct hud_export_segment *open_segment(const char *name)
+{
+    char segment_name[128];
+    const struct hud_export_segment *segment = NULL;
+
+    hud_export_segment_name(segment_name, sizeof(segment_name), name);
+
+#ifdef _WIN32
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, segment_name);
+
+    if (mapping) {
+        segment = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(*segment));
+        CloseHandle(mapping);
+    }
+#else
+    int fd = shm_open(segment_name, O_RDONLY, 0);
+
+    if (fd >= 0) {
+        void *data = mmap(NULL, sizeof(*segment), PROT_READ, MAP_SHARED, fd, 0);
+
+        if (data != MAP_FAILED)
+            segment = data;
+
+        close(fd);
+    }
+#endif
+
+    if (!segment) {
+        fprintf(stderr, "%s: unable to open the segment, is the export enabled?\n", segment_name);
+        return NULL;
+    }
+
+    if (segment->magic != HUD_EXPORT_MAGIC || segment->version != HUD_EXPORT_VERSION || segment->size != sizeof(*segment)) {
+        fprintf(stderr, "%s: unsupported segment\n", segment_name);
+        return NULL;
+    }
+
+    return segment;
+}
+
+/*
+ * same clock as os_gettime_ns() of libobs
+ */
+static uint64_t monotonic_ns(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static void sleep_ms(unsigned ms)
+{
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    usleep(ms * 1000);
+#endif
+}
+
+static void print_state(const struct hud_export_state *state)
+{
+    double age_ms = (double)(monotonic_ns() - state->timestamp_ns) / 1e6;
+
+    printf("frame %llu hud %s character %s spectate %s confidence", (unsigned long long)state->frame, state->hud, state->character_name,
+           state->spectate_color_name);
+
+    for (int i = 0; i < HUD_EXPORT_BANNERS; i++)
+        printf(" %.2f", state->confidence[i]);
+
+    printf(" changes squads %u kills %u", state->counter_changes[0], state->counter_changes[1]);
+
+    printf(" (%.3f ms ago)\n", age_ms);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || (argc == 3 && strcmp(argv[2], "-1") != 0) || argc > 3) {
+        fprintf(stderr, "usage: %s <name> [-1]\n", argv[0]);
+        return 1;
+    }
+
+    const struct hud_export_segment *segment = open_segment(argv[1]);
+
+    if (!segment)
+        return 1;
+
+    bool once = argc == 3;
+    uint64_t last_frame = 0;
+    struct hud_export_state state;
+
+    for (;;) {
+        if (!hud_export_try_read(segment, &state)) {
+            sleep_ms(1);
+            continue;
+        }
+
+        if (state.frame != last_frame) {
+            print_state(&state);
+            last_frame = state.frame;
+        }
+
+        if (once)
+            return 0;
+
+        sleep_ms(POLL_INTERVAL_MS);
+    }
+}
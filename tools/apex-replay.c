@@ -0,0 +1,486 @@
+/*
+ * prints the records of a recording made by the plugin and optionally
+ * extracts the recorded frames and scores them against a layout pack.
+ *
+ *   apex-replay <recording.apxr> [-o <directory>] [-p <layout.apxl>]
+ *
+ * -o writes one PNG per record: full frames as they were captured, area
+ * records as the recorded rectangles on a black frame.
+ *
+ * -p scores the recorded areas against the references and the thresholds of
+ * the pack, as apex-calibrate does, so that a new pack can be checked on the
+ * frames of a session before being loaded in the plugin. it also reports how
+ * many characters the prefilter of the plugin rules out per frame.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tools-common.h"
+#include "../src/area-prefilter.h"
+#include "../src/frame-recording.h"
+#include "../src/lz4-block.h"
+
+static const char *output_dir;
+static bool pack_loaded;
+
+struct prefilter_benchmark
+{
+    uint64_t frames;
+    uint64_t candidates;
+    uint64_t rejects[METRICS_NUM][PREFILTER_LEVELS];
+    uint64_t false_rejects[METRICS_NUM];
+};
+
+static struct prefilter_reference pg_prefilters[DISPLAY_RESOLUTIONS][CHARACTERS_NUM];
+static struct prefilter_benchmark benchmark;
+
+static uint8_t clamp_channel(int32_t value)
+{
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+static void set_yuv_pixel(PIX *pix, const int32_t (*m)[4], uint32_t x, uint32_t y, int32_t luma, int32_t u, int32_t v)
+{
+    pixSetRGBPixel(pix, x, y,
+                   clamp_channel((m[0][0] * luma + m[0][1] * u + m[0][2] * v + m[0][3]) >> 16),
+                   clamp_channel((m[1][0] * luma + m[1][1] * u + m[1][2] * v + m[1][3]) >> 16),
+                   clamp_channel((m[2][0] * luma + m[2][1] * u + m[2][2] * v + m[2][3]) >> 16));
+}
+
+static size_t full_frame_size(const struct recording_record *record)
+{
+    size_t pixels = (size_t)record->width * record->height;
+
+    switch (record->format) {
+    case RECORDING_FORMAT_RGBA:
+    case RECORDING_FORMAT_BGRA:
+        return pixels * 4;
+    case RECORDING_FORMAT_NV12:
+        return pixels + (size_t)record->width * (record->height / 2);
+    case RECORDING_FORMAT_I420:
+        return pixels + 2 * (size_t)(record->width / 2) * (record->height / 2);
+    default:
+        return 0;
+    }
+}
+
+static PIX *full_frame_pix(const struct recording_record *record, const uint8_t *payload)
+{
+    uint32_t w = record->width, h = record->height;
+    const uint8_t *luma = payload;
+    const uint8_t *chroma = payload + (size_t)w * h;
+    PIX *pix = pixCreate(w, h, 32);
+
+    for (uint32_t y = 0; y < h; y++) {
+        for (uint32_t x = 0; x < w; x++) {
+            const uint8_t *p = payload + ((size_t)y * w + x) * 4;
+
+            switch (record->format) {
+            case RECORDING_FORMAT_RGBA:
+                pixSetRGBPixel(pix, x, y, p[0], p[1], p[2]);
+                break;
+            case RECORDING_FORMAT_BGRA:
+                pixSetRGBPixel(pix, x, y, p[2], p[1], p[0]);
+                break;
+            case RECORDING_FORMAT_NV12:
+                p = chroma + (size_t)(y / 2) * w + (x / 2) * 2;
+                set_yuv_pixel(pix, record->yuv_matrix, x, y, luma[(size_t)y * w + x], p[0], p[1]);
+                break;
+            case RECORDING_FORMAT_I420:
+                p = chroma + (size_t)(y / 2) * (w / 2) + (x / 2);
+                set_yuv_pixel(pix, record->yuv_matrix, x, y, luma[(size_t)y * w + x], p[0], p[(size_t)(w / 2) * (h / 2)]);
+                break;
+            }
+        }
+    }
+
+    return pix;
+}
+
+/*
+ * the rectangles are checked against the record size before being copied
+ */
+static PIX *areas_pix(const struct recording_record *record, const uint8_t *payload, size_t size)
+{
+    PIX *pix = pixCreate(record->width, record->height, 32);
+    size_t offset = 0;
+
+    for (uint32_t i = 0; i < record->areas; i++) {
+        struct recording_area rect;
+
+        if (size - offset < sizeof(rect))
+            goto invalid;
+
+        memcpy(&rect, payload + offset, sizeof(rect));
+        offset += sizeof(rect);
+
+        if (rect.x + rect.w > record->width || rect.y + rect.h > record->height || (size - offset) / sizeof(uint32_t) / (rect.w ? rect.w : 1) < rect.h)
+            goto invalid;
+
+        l_uint32 *data = pixGetData(pix);
+        int wpl = pixGetWpl(pix);
+
+        for (uint32_t y = 0; y < rect.h; y++) {
+            memcpy(data + (rect.y + y) * wpl + rect.x, payload + offset, rect.w * sizeof(uint32_t));
+            offset += rect.w * sizeof(uint32_t);
+        }
+    }
+
+    return pix;
+
+invalid:
+    pixDestroy(&pix);
+    return NULL;
+}
+
+/*
+ * an area is scored only when it was recorded at both of the positions
+ * checked by the plugin, full frames have all of them
+ */
+static bool area_recorded(const struct recording_record *record, const uint8_t *payload, const struct layout_pack_area *a, int32_t xoff)
+{
+    if (record->flags & RECORD_FULL_FRAME)
+        return true;
+
+    bool found[2] = { false, !xoff };
+    size_t offset = 0;
+
+    for (uint32_t i = 0; i < record->areas; i++) {
+        struct recording_area rect;
+
+        memcpy(&rect, payload + offset, sizeof(rect));
+        offset += sizeof(rect) + (size_t)rect.w * rect.h * sizeof(uint32_t);
+
+        if (rect.y != a->y || rect.w != a->w || rect.h != a->h)
+            continue;
+
+        if (rect.x == a->x)
+            found[0] = true;
+        else if (rect.x == a->x + xoff)
+            found[1] = true;
+    }
+
+    return found[0] && found[1];
+}
+
+static void init_prefilters(void)
+{
+    for (int ds = 0; ds < DISPLAY_RESOLUTIONS; ds++) {
+        for (int pg = 0; pg < CHARACTERS_NUM; pg++) {
+            PIX *reference = references[ds][AREAS_NUM + pg].pix;
+
+            if (reference)
+                prefilter_reference_init(&pg_prefilters[ds][pg], pixGetData(reference), pixGetWpl(reference), pixGetWidth(reference),
+                                         pixGetHeight(reference), NCC_MASK_MIN_LUMA);
+        }
+    }
+}
+
+/*
+ * largest sum of squared differences of the area with a PSNR above threshold
+ */
+static double psnr_max_ssd(const struct layout_pack_area *a, float threshold)
+{
+    return 3.0 * 255.0 * 255.0 * a->w * a->h * pow(10.0, -threshold / 10.0);
+}
+
+/*
+ * a reject is false when the full comparison would have matched, it never
+ * happens unless the bounds are broken
+ */
+static void benchmark_prefilter(PIX *frame, int ds, const struct layout_pack_area *a, const float *thresholds)
+{
+    struct prefilter_frame sat = { 0, 0, malloc(prefilter_sat_size(a->w, a->h)) };
+    float scores[METRICS_NUM];
+    float bound;
+    double ssd_bound;
+
+    prefilter_frame_build(&sat, pixGetData(frame), pixGetWpl(frame), a->x, a->y, a->w, a->h);
+
+    benchmark.frames++;
+
+    for (int pg = 0; pg < CHARACTERS_NUM; pg++) {
+        const struct pack_reference *reference = &references[ds][AREAS_NUM + pg];
+
+        if (!reference->pix)
+            continue;
+
+        benchmark.candidates++;
+
+        /* the characters are never compared on glyphs */
+        for (int mm = 0; mm <= METRIC_LUMA_NCC; mm++) {
+            float threshold = thresholds[PG_BANNER_IMAGE * pack.header->metrics_num + mm];
+            int level = mm == METRIC_PSNR ? prefilter_reject_ssd(&sat, &pg_prefilters[ds][pg], psnr_max_ssd(a, threshold), &ssd_bound)
+                                          : prefilter_reject_ncc(&sat, &pg_prefilters[ds][pg], threshold, &bound);
+
+            if (level < 0)
+                continue;
+
+            benchmark.rejects[mm][level]++;
+
+            score_area(frame, reference, a, 0, scores);
+
+            if (scores[mm] > threshold)
+                benchmark.false_rejects[mm]++;
+        }
+    }
+
+    free(sat.sat);
+}
+
+static void print_benchmark(void)
+{
+    if (!benchmark.frames)
+        return;
+
+    printf("character prefilter over %llu frames, %.2f candidates per frame\n", (unsigned long long)benchmark.frames,
+           (double)benchmark.candidates / benchmark.frames);
+
+    for (int mm = 0; mm <= METRIC_LUMA_NCC; mm++) {
+        uint64_t rejects = 0;
+
+        printf("    %-4s rejects per frame", match_metric_str[mm]);
+
+        for (int level = 0; level < PREFILTER_LEVELS; level++) {
+            rejects += benchmark.rejects[mm][level];
+            printf(" level %d %.2f", level, (double)benchmark.rejects[mm][level] / benchmark.frames);
+        }
+
+        printf(" total %.2f, false rejects %llu\n", (double)rejects / benchmark.frames, (unsigned long long)benchmark.false_rejects[mm]);
+    }
+}
+
+static void score_record(const struct recording_record *record, const uint8_t *payload, PIX *frame)
+{
+    int ds = find_display(record->width, record->height);
+
+    if (ds < 0 || record->language >= LANGUAGES)
+        return;
+
+    const struct layout_pack_area *areas = layout_pack_areas(&pack, ds, record->language);
+    const int32_t *offsets = layout_pack_offsets(&pack, ds);
+    const float *thresholds = layout_pack_thresholds(&pack, ds);
+
+    for (uint32_t an = 0; an < AREAS_NUM; an++) {
+        const struct layout_pack_area *a = &areas[an];
+        float scores[METRICS_NUM];
+        float best[METRICS_NUM] = { 0.0f, -1.0f };
+        int best_pg = -1;
+
+        if (!area_recorded(record, payload, a, an == PG_BANNER_IMAGE ? 0 : offsets[an]))
+            continue;
+
+        if (an != PG_BANNER_IMAGE) {
+            if (!references[ds][an].pix)
+                continue;
+
+            score_area(frame, &references[ds][an], a, offsets[an], best);
+        } else {
+            benchmark_prefilter(frame, ds, a, thresholds);
+
+            for (uint32_t pg = 0; pg < CHARACTERS_NUM; pg++) {
+                if (!references[ds][AREAS_NUM + pg].pix)
+                    continue;
+
+                score_area(frame, &references[ds][AREAS_NUM + pg], a, 0, scores);
+
+                if (scores[METRIC_LUMA_NCC] > best[METRIC_LUMA_NCC]) {
+                    best[METRIC_PSNR] = scores[METRIC_PSNR];
+                    best[METRIC_LUMA_NCC] = scores[METRIC_LUMA_NCC];
+                    best_pg = pg;
+                }
+            }
+        }
+
+        printf("    %-26s", area_name_str[an]);
+
+        for (int mm = 0; mm < METRICS_NUM; mm++) {
+            float threshold = thresholds[an * pack.header->metrics_num + mm];
+
+            printf(" %s %7.3f %s %7.3f", match_metric_str[mm], best[mm], best[mm] > threshold ? ">" : "<=", threshold);
+        }
+
+        if (best_pg >= 0)
+            printf(" %s", character_name_str[best_pg]);
+
+        printf("\n");
+    }
+}
+
+static void print_record(const struct recording_record *record, uint64_t start_ns)
+{
+    printf("%6u %10.3f s %ux%u %s %s", record->frame, (double)(record->timestamp_ns - start_ns) / 1e9, record->width, record->height,
+           record->language < LANGUAGES ? game_language_str[record->language] : "-",
+           record->input < INPUT_DEVICES_NUM ? input_device_str[record->input] : "-");
+
+    printf(" banners");
+
+    if (!record->banners)
+        printf(" -");
+
+    for (int bp = 0; bp < BANNER_POSITION_NUM; bp++)
+        if (record->banners & (1 << bp))
+            printf(" %s", banner_position_str[bp]);
+
+    printf(" character %s spectate %s %s\n",
+           record->character < CHARACTERS_NUM ? character_name_str[record->character] : "-",
+           record->spectate_color < SPECTATE_COLORS_NUM ? spectate_color_str[record->spectate_color] : "-",
+           (record->flags & RECORD_FULL_FRAME) ? "frame" : "areas");
+}
+
+static bool process_record(const struct recording_record *record, const uint8_t *payload, uint64_t start_ns)
+{
+    print_record(record, start_ns);
+
+    if ((record->flags & RECORD_FULL_FRAME) && record->raw_size != full_frame_size(record))
+        return false;
+
+    if (!output_dir && !pack_loaded)
+        return true;
+
+    PIX *frame = (record->flags & RECORD_FULL_FRAME) ? full_frame_pix(record, payload) : areas_pix(record, payload, record->raw_size);
+
+    if (!frame)
+        return false;
+
+    if (output_dir) {
+        char path[1024];
+
+        snprintf(path, sizeof(path), "%s/frame_%06u.png", output_dir, record->frame);
+
+        if (pixWrite(path, frame, IFF_PNG) != 0)
+            fprintf(stderr, "%s: unable to write\n", path);
+    }
+
+    if (pack_loaded)
+        score_record(record, payload, frame);
+
+    pixDestroy(&frame);
+
+    return true;
+}
+
+static bool replay(const char *path)
+{
+    size_t size = 0;
+    uint8_t *data = read_file(path, &size);
+    uint8_t *buffer = NULL;
+    size_t capacity = 0;
+    bool success = false;
+
+    if (!data) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    struct recording_header header;
+
+    if (size < sizeof(header)) {
+        fprintf(stderr, "%s: not a recording\n", path);
+        goto out;
+    }
+
+    memcpy(&header, data, sizeof(header));
+
+    if (header.magic != RECORDING_MAGIC || header.version != RECORDING_VERSION) {
+        fprintf(stderr, "%s: not a recording or version %u is not supported\n", path, header.version);
+        goto out;
+    }
+
+    size_t offset = sizeof(header);
+    uint32_t records = 0;
+
+    while (offset < size) {
+        struct recording_record record;
+
+        /* the last record of a recording that was not stopped may be partial */
+        if (size - offset < sizeof(record)) {
+            fprintf(stderr, "%s: truncated record at %zu\n", path, offset);
+            break;
+        }
+
+        memcpy(&record, data + offset, sizeof(record));
+        offset += sizeof(record);
+
+        if (size - offset < record.size) {
+            fprintf(stderr, "%s: truncated record at %zu\n", path, offset);
+            break;
+        }
+
+        const uint8_t *payload = data + offset;
+
+        offset += record.size;
+
+        if (record.flags & RECORD_COMPRESSED) {
+            if (record.raw_size > capacity) {
+                buffer = realloc(buffer, record.raw_size);
+                capacity = record.raw_size;
+            }
+
+            if (!lz4_decompress(payload, record.size, buffer, record.raw_size)) {
+                fprintf(stderr, "%s: invalid compressed record %u\n", path, record.frame);
+                continue;
+            }
+
+            payload = buffer;
+        } else if (record.size != record.raw_size) {
+            fprintf(stderr, "%s: invalid record %u\n", path, record.frame);
+            continue;
+        }
+
+        if (!process_record(&record, payload, header.start_ns))
+            fprintf(stderr, "%s: invalid record %u\n", path, record.frame);
+
+        records++;
+    }
+
+    printf("%u records\n", records);
+
+    print_benchmark();
+
+    success = true;
+
+out:
+    free(buffer);
+    free(data);
+
+    return success;
+}
+
+int main(int argc, char **argv)
+{
+    const char *recording = NULL;
+    const char *pack_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            output_dir = argv[++i];
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+            pack_path = argv[++i];
+        else if (!recording && argv[i][0] != '-')
+            recording = argv[i];
+        else {
+            recording = NULL;
+            break;
+        }
+    }
+
+    if (!recording) {
+        fprintf(stderr, "usage: %s <recording.apxr> [-o <directory>] [-p <layout.apxl>]\n", argv[0]);
+        return 1;
+    }
+
+    if (pack_path) {
+        if (!load_pack(pack_path))
+            return 1;
+
+        init_prefilters();
+        pack_loaded = true;
+    }
+
+    return replay(recording) ? 0 : 1;
+}
@@ -0,0 +1,212 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/area-scores.h"
+#include "../src/ssd-kernels.h"
+
+#include "tools-common.h"
+
+struct layout_pack pack;
+struct pack_reference references[DISPLAY_RESOLUTIONS][REFERENCES_NUM];
+
+uint8_t *read_file(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+
+    if (!f)
+        return NULL;
+
+    uint8_t *data = NULL;
+    long end = -1;
+
+    if (fseek(f, 0, SEEK_END) == 0)
+        end = ftell(f);
+
+    if (end < 0 || fseek(f, 0, SEEK_SET) != 0)
+        goto done;
+
+    *size = (size_t)end;
+    data = malloc(*size ? *size : 1);
+
+    if (!data) {
+        errno = ENOMEM;
+        goto done;
+    }
+
+    if (fread(data, 1, *size, f) != *size) {
+        if (!ferror(f))
+            errno = EIO;
+
+        free(data);
+        data = NULL;
+    }
+
+done:
+    fclose(f);
+
+    return data;
+}
+
+static bool reference_from_pack(struct pack_reference *reference, const struct layout_pack_reference *ref)
+{
+    memset(reference, 0, sizeof(*reference));
+
+    if (!ref->width || !ref->height)
+        return true;
+
+    const uint32_t *src = layout_pack_pixels(&pack, ref);
+
+    reference->plane_size = (size_t)ref->width * ref->height;
+    reference->planes = malloc(reference->plane_size * REFERENCE_PLANES_NUM);
+    reference->pix = pixCreateNoInit(ref->width, ref->height, 32);
+
+    if (!reference->planes || !reference->pix)
+        return false;
+
+    l_uint32 *dst = pixGetData(reference->pix);
+    int wpl = pixGetWpl(reference->pix);
+
+    for (uint32_t y = 0; y < ref->height; y++)
+        memcpy(dst + y * wpl, src + y * ref->width, ref->width * sizeof(uint32_t));
+
+    area_reference_planes(reference->planes, reference->plane_size, src, ref->width, ref->width, ref->height, NCC_MASK_MIN_LUMA);
+    glyph_mask_build(&reference->glyph, src, ref->width, ref->width, ref->height, GLYPH_COLOR_SLACK);
+
+    return true;
+}
+
+bool load_pack(const char *path)
+{
+    uint8_t *data = read_file(path, &pack.size);
+
+    if (!data) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    pack.data = data;
+    pack.header = (const struct layout_pack_header *)data;
+
+    const struct layout_pack_header *h = pack.header;
+
+    if (pack.size < sizeof(struct layout_pack_header) || h->magic != LAYOUT_PACK_MAGIC || h->size != pack.size) {
+        fprintf(stderr, "%s: not a layout pack\n", path);
+        return false;
+    }
+
+    if (h->version != LAYOUT_PACK_VERSION) {
+        fprintf(stderr, "%s: version %u is not supported\n", path, h->version);
+        return false;
+    }
+
+    if (h->metrics_num < METRICS_NUM) {
+        fprintf(stderr, "%s: thresholds of %u metrics, export a new pack from the plugin\n", path, h->metrics_num);
+        return false;
+    }
+
+    if (h->resolutions != DISPLAY_RESOLUTIONS || h->languages != LANGUAGES || h->areas_num != AREAS_NUM || h->characters_num != CHARACTERS_NUM) {
+        fprintf(stderr, "%s: tables do not match this version of the tool\n", path);
+        return false;
+    }
+
+    for (uint32_t ds = 0; ds < DISPLAY_RESOLUTIONS; ds++) {
+        for (uint32_t i = 0; i < REFERENCES_NUM; i++) {
+            if (!reference_from_pack(&references[ds][i], layout_pack_reference(&pack, ds, i))) {
+                fprintf(stderr, "%s: out of memory\n", path);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static const uint32_t *area_pixels(PIX *frame, const struct layout_pack_area *a, int32_t xoff)
+{
+    return pixGetData(frame) + a->y * pixGetWpl(frame) + a->x + xoff;
+}
+
+/*
+ * the scores of the plugin, see area-scores.h
+ */
+static float psnr_score(PIX *frame, const struct pack_reference *reference, const struct layout_pack_area *a, int32_t xoff)
+{
+    uint64_t ssd = ssd_kernel_generic(area_pixels(frame, a, xoff), pixGetWpl(frame), reference->planes, reference->plane_size, a->w, a->h);
+
+    return ssd_psnr(ssd, (uint64_t)a->w * a->h);
+}
+
+static float ncc_score(PIX *frame, const struct pack_reference *reference, const struct layout_pack_area *a, int32_t xoff)
+{
+    const uint8_t *luma = reference->planes + REFERENCE_LUMA * reference->plane_size;
+    const uint8_t *mask = reference->planes + REFERENCE_MASK * reference->plane_size;
+
+    return area_ncc(area_pixels(frame, a, xoff), pixGetWpl(frame), luma, mask, a->w, a->h);
+}
+
+static float glyph_score(PIX *frame, const struct pack_reference *reference, const struct layout_pack_area *a, int32_t xoff)
+{
+    const struct glyph_mask *mask = &reference->glyph;
+
+    if (mask->w != a->w || mask->h != a->h)
+        return 0.0f;
+
+    struct glyph_match match;
+
+    glyph_mask_match(mask, area_pixels(frame, a, xoff), pixGetWpl(frame), &match);
+
+    return glyph_mask_score(mask, &match);
+}
+
+int find_name(const char **names, size_t count, const char *name)
+{
+    for (size_t i = 0; i < count; i++)
+        if (strcmp(names[i], name) == 0)
+            return (int)i;
+
+    return -1;
+}
+
+int find_display(uint32_t width, uint32_t height)
+{
+    for (int ds = 0; ds < DISPLAY_RESOLUTIONS; ds++)
+        if (display_sizes[ds][0] == width && display_sizes[ds][1] == height)
+            return ds;
+
+    return -1;
+}
+
+/*
+ * best score of the two positions checked by the plugin
+ */
+void score_area(PIX *frame, const struct pack_reference *reference, const struct layout_pack_area *a, int32_t xoff, float scores[METRICS_NUM])
+{
+    if (pixGetWidth(reference->pix) != (l_int32)a->w || pixGetHeight(reference->pix) != (l_int32)a->h) {
+        for (int mm = 0; mm < METRICS_NUM; mm++)
+            scores[mm] = 0.0f;
+
+        return;
+    }
+
+    scores[METRIC_PSNR] = psnr_score(frame, reference, a, 0);
+    scores[METRIC_LUMA_NCC] = ncc_score(frame, reference, a, 0);
+    scores[METRIC_GLYPH_MASK] = glyph_score(frame, reference, a, 0);
+
+    if (!xoff)
+        return;
+
+    float psnr = psnr_score(frame, reference, a, xoff);
+    float ncc = ncc_score(frame, reference, a, xoff);
+    float glyph = glyph_score(frame, reference, a, xoff);
+
+    if (psnr > scores[METRIC_PSNR])
+        scores[METRIC_PSNR] = psnr;
+
+    if (ncc > scores[METRIC_LUMA_NCC])
+        scores[METRIC_LUMA_NCC] = ncc;
+
+    if (glyph > scores[METRIC_GLYPH_MASK])
+        scores[METRIC_GLYPH_MASK] = glyph;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <leptonica/allheaders.h>
+
+#include "../src/glyph-mask.h"
+#include "../src/hud-tables.h"
+#include "../src/layout-pack.h"
+
+/*
+ * the layout pack loaded by the tools and the scores of its references, the
+ * tables and the scoring code are the ones of the plugin
+ */
+
+#define REFERENCES_NUM      (AREAS_NUM + CHARACTERS_NUM)
+
+/*
+ * planes of plane_size bytes as in the arenas of the plugin, see
+ * area-scores.h
+ */
+struct pack_reference
+{
+    PIX *pix;
+    uint8_t *planes;
+    size_t plane_size;
+    struct glyph_mask glyph;
+};
+
+extern struct layout_pack pack;
+extern struct pack_reference references[DISPLAY_RESOLUTIONS][REFERENCES_NUM];
+
+/*
+ * NULL with errno set on failure
+ */
+uint8_t *read_file(const char *path, size_t *size);
+bool load_pack(const char *path);
+
+int find_name(const char **names, size_t count, const char *name);
+int find_display(uint32_t width, uint32_t height);
+
+void score_area(PIX *frame, const struct pack_reference *reference, const struct layout_pack_area *a, int32_t xoff, float scores[METRICS_NUM]);